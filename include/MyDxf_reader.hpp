@@ -1,6 +1,11 @@
 ﻿#pragma once
 #include "libdxfrw.h"
+#include "libdwgr.h"
 #include "utils.h"
+#include "containment.h"
+#include "hatch_boundary.h"
+#include "region.h"
+#include "trace.h"
 // 继承 DRW_Interface，用于接收解析到的图元
 
 class MyDXFReader : public DRW_Interface
@@ -10,6 +15,8 @@ public:
     int poly_count, circle_count;
     std::string _obj_save_path;
     std::vector<RawPoly> polys;
+    bool verbose = true; // 是否逐个打印解析到的图元
+    const Region *region = nullptr; // 非空时丢弃包围盒与区域不相交的图元，不复制其顶点
 
     MyDXFReader(float height, std::string path)
         : defaultHeight(height), _obj_save_path(path), poly_count(0), circle_count(0)
@@ -18,113 +25,184 @@ public:
 
     void addCircle(const DRW_Circle &data) override
     {
-        std::cout << "Circle: center("
-                  << data.basePoint.x << ", " << data.basePoint.y
-                  << "), radius=" << data.radious << "\n";
-
-        const int segments = 64;
-        RawPoly p;
-        p.area = 0;
-        for (int i = 0; i < segments; i++)
+        if (region)
         {
-            double theta = 2.0 * M_PI * i / segments;
-            Vertex V{(float)(data.basePoint.x + cos(theta) * data.radious),
-                     (float)(data.basePoint.y + sin(theta) * data.radious),
-                     0.0f};
-            p.pts.push_back(V);
+            Bounds b;
+            b.add(data.basePoint.x - data.radious, data.basePoint.y - data.radious);
+            b.add(data.basePoint.x + data.radious, data.basePoint.y + data.radious);
+            if (!region->mayIntersect(b))
+                return;
         }
-        p.area = polygonSignedArea(p.pts);
-        polys.push_back(std::move(p));
+        TraceScope trace("addCircle");
+        if (verbose)
+            std::cout << "Circle: center("
+                      << data.basePoint.x << ", " << data.basePoint.y
+                      << "), radius=" << data.radious << "\n";
+
+        const int segments = 64;
+        polys.push_back(makeCirclePoly(data.basePoint.x, data.basePoint.y, data.radious, segments));
+        polys.back().layer = data.layer;
     }
 
     void addLWPolyline(const DRW_LWPolyline &data) override
     {
         if (data.vertlist.empty())
             return;
-        std::cout << "LWPolyline: " << data.vertlist.size() << " vertices\n";
+        if (region)
+        {
+            Bounds b;
+            for (const auto &v : data.vertlist)
+                b.add(v->x, v->y);
+            if (!region->mayIntersect(b))
+                return;
+        }
+        TraceScope trace("addLWPolyline");
+        trace.arg("vertices", (int64_t)data.vertlist.size());
+        if (verbose)
+            std::cout << "LWPolyline: " << data.vertlist.size() << " vertices\n";
 
         RawPoly p;
         p.area = 0;
+        p.layer = data.layer;
+        p.pts.reserve(data.vertlist.size());
         for (const auto &v : data.vertlist)
         {
-            std::cout << "   (" << v->x << ", " << v->y << ")\n";
+            if (verbose)
+                std::cout << "   (" << v->x << ", " << v->y << ")\n";
             Vertex V({(float)v->x, (float)v->y, 0.0f});
             p.pts.push_back(V);
         }
-        p.area = polygonSignedArea(p.pts);
-        // if poly closed? sometimes last equals first, remove duplicate last if present
-        if (p.pts.size() > 1)
-        {
-            if (std::fabs(p.pts.front().x - p.pts.back().x) < 1e-6f &&
-                std::fabs(p.pts.front().y - p.pts.back().y) < 1e-6f)
-            {
-                p.pts.pop_back();
-            }
-        }
+        // 计算面积；闭合折线的最后一点往往与首点重合，重复的尾点会被去掉
+        finalizeRawPoly(p);
         polys.push_back(std::move(p));
     }
 
-    std::vector<std::pair<RawPoly, std::vector<RawPoly>>> groupOuterWithHoles()
+    // HATCH 的边界环自带外环/洞结构，成组后直接进入 polys，不再参与包含关系推断。
+    // 多段线边界按凸度生成圆弧；边界由边组成时支持直线、圆弧与椭圆弧，
+    // libdxfrw 不解析样条边的数据，样条边两端由相邻边直接连上
+    void addHatch(const DRW_Hatch *data) override
     {
-        size_t m = polys.size();
-        std::vector<int> parent(m, -1); // 父级多边形索引（即它所属的外环）
-        // 计算多边形的面积，因为计算方法的限制，面积可能为负数（取决于顶点顺序），所以取绝对值
-        std::vector<double> absArea(m);
-        for (size_t i = 0; i < m; i++)
-            absArea[i] = std::abs(polys[i].area);
+        TraceScope trace("addHatch");
+        trace.arg("loops", (int64_t)data->looplist.size());
+        if (verbose)
+            std::cout << "Hatch: " << data->looplist.size() << " loops\n";
 
-        // 对每个多边形 j，取它的第一个顶点作为测试点
-        // 寻找包含该点的面积最小多边形 i，作为它的父级
-        for (size_t j = 0; j < m; j++)
+        std::vector<std::vector<Vertex>> loops;
+        std::vector<Vertex> edge;
+        for (const auto &loop : data->looplist)
         {
-            // pick a test point from polys[j], e.g. first vertex
-            if (polys[j].pts.empty())
-                continue;
-            double tx = polys[j].pts[0].x;
-            double ty = polys[j].pts[0].y;
-            int best = -1;
-            double bestArea = 1e300;
-            for (size_t i = 0; i < m; i++)
+            std::vector<Vertex> ring;
+            for (const auto &obj : loop->objlist)
             {
-                if (i == j)
-                    continue; // 不跟自己比较
-                if (absArea[i] <= absArea[j])
-                    continue; // 外环面积必须更大
-                if (pointInPoly(polys[i].pts, tx, ty))
+                switch (obj->eType)
                 {
-                    if (absArea[i] < bestArea)
+                case DRW::LWPOLYLINE:
+                {
+                    const auto &vl = static_cast<const DRW_LWPolyline &>(*obj).vertlist;
+                    for (size_t i = 0; i < vl.size(); i++)
                     {
-                        bestArea = absArea[i];
-                        best = (int)i;
+                        const auto &a = vl[i], &b = vl[(i + 1) % vl.size()];
+                        appendBulgeSegment(ring, a->x, a->y, b->x, b->y, a->bulge);
                     }
+                    break;
+                }
+                case DRW::LINE:
+                {
+                    const auto &l = static_cast<const DRW_Line &>(*obj);
+                    hatchLineEdge(edge, l.basePoint.x, l.basePoint.y, l.secPoint.x, l.secPoint.y);
+                    break;
+                }
+                case DRW::ARC:
+                {
+                    const auto &a = static_cast<const DRW_Arc &>(*obj);
+                    hatchArcEdge(edge, a.basePoint.x, a.basePoint.y, a.radious, a.staangle, a.endangle, a.isccw != 0);
+                    break;
                 }
+                case DRW::ELLIPSE:
+                {
+                    const auto &e = static_cast<const DRW_Ellipse &>(*obj);
+                    hatchEllipseEdge(edge, e.basePoint.x, e.basePoint.y, e.secPoint.x, e.secPoint.y,
+                                     e.ratio, e.staparam, e.endparam, e.isccw != 0);
+                    break;
+                }
+                default:
+                    break;
+                }
+                appendHatchEdge(ring, edge);
             }
-            parent[j] = best; // -1 means no parent -> it's an outer candidate
+            loops.push_back(std::move(ring));
         }
+        if (region)
+        {
+            // 外环包住所有洞，整个 HATCH 要么保留要么丢弃
+            Bounds b;
+            for (const auto &ring : loops)
+                for (const auto &v : ring)
+                    b.add(v.x, v.y);
+            if (!region->mayIntersect(b))
+                return;
+        }
+        appendHatchLoops(loops, data->layer, polys);
+    }
 
-        // 创建一个新的 group（pair），外环放在 first，空洞初始化为空 second
-        std::vector<std::pair<RawPoly, std::vector<RawPoly>>> groups;
+    // 分组只返回下标，不复制顶点；用 PolyGrouping::rings 取得某组的环视图。
+    // threads 为包含关系扫描的线程数（0 表示全部硬件线程），分组结果与线程数无关
+    PolyGrouping groupOuterWithHoles(unsigned threads = 1) const
+    {
+        size_t m = polys.size();
+        // 平面扫描一次建立完整的包含树（父级为直接包含它的最小多边形），HATCH 的环不参与
+        ContainmentTree tree = buildContainmentTree(polys, threads);
+
+        // 偶数深度为外环：每个外环创建一个新的 group。
+        // 洞里的岛同样是偶数深度，因此会成为独立的 group 而不会丢失。
+        // HATCH 外环直接成组，其后紧跟的 HatchHole 就是它的洞
+        PolyGrouping grouping;
         std::vector<int> outerIndexMap(m, -1);
+        std::vector<int> holeOwner(m, -1); // 洞所属的 group
+        int hatchGroup = -1;
         for (size_t i = 0; i < m; i++)
         {
-            if (parent[i] == -1)
+            const RingRole role = polys[i].role;
+            if (role == RingRole::HatchHole)
+                holeOwner[i] = hatchGroup;
+            else if (role == RingRole::HatchOuter || tree.depth[i] % 2 == 0)
             { // outer
-                outerIndexMap[i] = (int)groups.size();
-                groups.push_back({polys[i], {}});
+                outerIndexMap[i] = (int)grouping.groups.size();
+                grouping.groups.push_back({i, 0, 0});
+                if (role == RingRole::HatchOuter)
+                    hatchGroup = outerIndexMap[i];
             }
         }
-        // assign holes
+        // assign holes：奇数深度挂到其父级（偶数深度）所在的 group。先计数，再按组连续排列洞下标
         for (size_t j = 0; j < m; j++)
+            if (polys[j].role == RingRole::Free && tree.depth[j] % 2 == 1)
+                holeOwner[j] = outerIndexMap[tree.parent[j]];
+        for (size_t j = 0; j < m; j++)
+            if (holeOwner[j] >= 0)
+                grouping.groups[holeOwner[j]].holeCount++;
+        size_t offset = 0;
+        for (auto &g : grouping.groups)
         {
-            if (parent[j] != -1)
-            {
-                int p = parent[j];
-                int idx = outerIndexMap[p];
-                if (idx >= 0)
-                    groups[idx].second.push_back(polys[j]);
-            }
+            g.holeBegin = offset;
+            offset += g.holeCount;
+        }
+        grouping.holes.resize(offset);
+        std::vector<size_t> filled(grouping.groups.size(), 0);
+        for (size_t j = 0; j < m; j++)
+        {
+            const int idx = holeOwner[j];
+            if (idx >= 0)
+                grouping.holes[grouping.groups[idx].holeBegin + filled[idx]++] = j;
         }
-        return groups;
+        return grouping;
+    }
+
+    // 一组处理完后释放其外环与洞的顶点，处理大图时内存随进度回落
+    void releaseGroup(const PolyGrouping &grouping, const PolyGroup &g)
+    {
+        std::vector<Vertex>().swap(polys[g.outer].pts);
+        for (size_t k = 0; k < g.holeCount; k++)
+            std::vector<Vertex>().swap(polys[grouping.holes[g.holeBegin + k]].pts);
     }
 
     // 其他接口：空实现即可（不关心）-------------------------------------------------------------
@@ -145,7 +223,6 @@ public:
     void addDimAngular3P(const DRW_DimAngular3p *) override {}
     void addDimOrdinate(const DRW_DimOrdinate *) override {}
     void addLeader(const DRW_Leader *) override {}
-    void addHatch(const DRW_Hatch *) override {}
     void addViewport(const DRW_Viewport &) override {}
     void addImage(const DRW_Image *) override {}
     void addInsert(const DRW_Insert &) override {}
@@ -180,3 +257,19 @@ public:
 
     void addComment(const char *) override {}
 };
+
+// 用 libdxfrw 读取 DXF，返回是否成功
+inline bool readWithLibdxfrw(const std::string &filename, MyDXFReader &reader)
+{
+    TraceScope trace("dxfRW::read");
+    dxfRW dxf(filename.c_str()); // 创建 DXF 读取对象
+    return dxf.read(&reader, false); // false 表示不保留块引用
+}
+
+// 用 libdxfrw 的 dwgR 直接读取 DWG，回调与 DXF 完全相同
+inline bool readWithDwgR(const std::string &filename, MyDXFReader &reader)
+{
+    TraceScope trace("dwgR::read");
+    dwgR dwg(filename.c_str());
+    return dwg.read(&reader, false);
+}
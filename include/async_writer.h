@@ -0,0 +1,61 @@
+﻿#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "bounded_queue.h"
+#include "io_ring.h"
+#include "output_sink.h"
+#include "utils.h"
+
+struct AsyncWriterOptions
+{
+    size_t maxBytesInFlight = 256u << 20; // 已提交但尚未写完的网格最多占用的内存
+    size_t queueSlots = 64;
+    bool useIoUring = true; // 可用时经由 io_uring 写盘，否则写出线程里阻塞写
+};
+
+// 独立的 OBJ 写出阶段：几何循环用 submit 交出做好的网格后立即返回，由写出线程格式化、压缩并落盘。
+// 只有在途网格超出内存上限或队列满时 submit 才会等待（背压）。两边等待时都阻塞在条件变量上，不占用 CPU；
+// 写出线程不向 std::cout 打印，写出的文件数见 stats
+class AsyncObjWriter
+{
+public:
+    // stats 只由写出线程更新，finish 之后才完整
+    AsyncObjWriter(const OutputOptions &output, OutputStats *stats, const AsyncWriterOptions &options = {});
+    ~AsyncObjWriter();
+    AsyncObjWriter(const AsyncObjWriter &) = delete;
+    AsyncObjWriter &operator=(const AsyncObjWriter &) = delete;
+
+    void submit(size_t index, std::vector<Vertex> &&verts);
+    // 写完队列中剩余的网格并结束写出线程
+    void finish();
+
+    bool usingIoUring() const { return ring != nullptr; }
+    // submit 因背压而等待的次数
+    size_t stalls() const { return stallCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Job
+    {
+        size_t index = 0;
+        std::vector<Vertex> verts;
+    };
+    void run();
+
+    BoundedQueue<Job> queue;
+    std::unique_ptr<IoRing> ring;
+    OutputOptions output;
+    OutputStats *stats;
+    size_t maxBytesInFlight;
+    std::atomic<size_t> bytesInFlight{0};
+    std::atomic<size_t> stallCount{0};
+    // 队列本身无锁，mutex 只用来配合条件变量：入队/出队后先取一次锁再通知，对方检查完条件到开始等待之间不会漏掉唤醒
+    std::mutex mutex;
+    std::condition_variable jobReady; // submit、finish 通知写出线程
+    std::condition_variable jobDone;  // 写出线程写完一个网格后通知等待背压的 submit
+    bool done = false;                // 受 mutex 保护
+    std::thread worker;
+};
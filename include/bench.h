@@ -0,0 +1,21 @@
+﻿#pragma once
+#include <string>
+
+// 命令行 --bench-* 对应的基准测试，结果打印到标准输出
+
+// dxfRW::read 与内存映射快速读取器（串行/并行）的解析耗时
+int benchParse(const std::string &filename, unsigned threads);
+// 直接读取 DWG 与外部转换为 DXF 再读取的耗时
+int benchDwg(const std::string &filename, std::string convertCmd);
+// earcut 与单调剖分在不同顶点数/洞数下的三角化耗时
+int benchTriangulation();
+// earcut 逐洞遍历外环与网格索引两种桥接查找在 1~10000 个洞下的耗时
+int benchHoleBridging();
+// earcut 耳尖检测：不哈希、哈希逐点、哈希批量 SIMD 三种路径的耗时，并核对批量路径与逐点路径的结果一致
+int benchEarTest();
+// 4~16 个顶点的无洞小多边形：earcut 与定长内核的耗时对比，并核对三角形数一致
+int benchSmallPolygons();
+// orient2d 普通浮点、浮点过滤 + 精确回退、纯精确三种实现的耗时与回退比例
+int benchPredicates();
+// 约 50 万个多边形的合成街区上，包含关系扫描在 1~64 个线程下的耗时，并核对结果与单线程一致
+int benchContainment();
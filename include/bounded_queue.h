@@ -0,0 +1,91 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+// 有界无锁多生产者多消费者队列（Vyukov 环形队列）：每个槽位带序号，
+// 生产者/消费者只在各自的游标上做一次 CAS，不需要互斥锁。容量向上取整到 2 的幂
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+    {
+        size_t n = 2;
+        while (n < capacity)
+            n <<= 1;
+        mask = n - 1;
+        slots.reset(new Slot[n]);
+        for (size_t i = 0; i < n; i++)
+            slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    size_t capacity() const { return mask + 1; }
+
+    // 队列满时返回 false，value 保持不变
+    bool tryPush(T &value)
+    {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot &slot = slots[pos & mask];
+            const size_t seq = slot.seq.load(std::memory_order_acquire);
+            const ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+            if (diff == 0)
+            {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.value = std::move(value);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    // 队列空时返回空
+    std::optional<T> tryPop()
+    {
+        size_t pos = head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot &slot = slots[pos & mask];
+            const size_t seq = slot.seq.load(std::memory_order_acquire);
+            const ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)(pos + 1);
+            if (diff == 0)
+            {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    std::optional<T> out(std::move(slot.value));
+                    slot.value = T();
+                    slot.seq.store(pos + mask + 1, std::memory_order_release);
+                    return out;
+                }
+            }
+            else if (diff < 0)
+                return std::nullopt;
+            else
+                pos = head.load(std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> seq;
+        T value;
+    };
+    std::unique_ptr<Slot[]> slots;
+    size_t mask = 0;
+    // 生产者与消费者游标放在不同的缓存行，避免伪共享
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) std::atomic<size_t> head{0};
+};
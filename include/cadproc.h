@@ -0,0 +1,93 @@
+﻿#pragma once
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "capacity.h"
+#include "polygon_union.h"
+#include "region.h"
+#include "run_report.h"
+#include "shard.h"
+#include "utils.h"
+
+// cadproc 库的入口：读取 DXF/DWG（文件或内存），分组、三角化、拉伸，
+// 每做好一个 group 就交给调用方，不经过磁盘。命令行程序本身也只是它的一个调用方
+
+struct ConvertOptions
+{
+    bool useFastReader = false; // ASCII DXF 先试内存映射快速读取器，不支持的内容自动回退到 libdxfrw
+    unsigned threads = 1;       // 快速读取器解析与包含关系扫描的线程数，0 表示使用全部硬件线程
+    float height = 100.0f;      // 拉伸高度
+    TriangulationOptions triangulation;
+    UnionMode unionMode = UnionMode::Off;
+    bool cullSharedWalls = false;
+    double wallTolerance = 1e-3;
+    // 感兴趣区域：读取时丢弃包围盒与之不相交的图元，只拉伸与之相交的 group；
+    // clipToRegion 时跨越区域边界的 group 裁剪到区域内
+    Region region;
+    bool clipToRegion = false;
+    // 分组后按外环包围盒中心的 Hilbert 序号重排 group，拉伸、回调与 GroupMesh::index 都按空间顺序进行
+    bool hilbertOrder = false;
+    // 分片转换中的一个 worker：只读取本格子附近的图元，只输出外环包围盒中心落在本格子里的 group；
+    // 伸出格子的 group 会按其包围盒扩大范围重读一次，保证洞完整
+    ShardSpec shard;
+    std::ostream *log = nullptr; // 非空时打印过程信息（与命令行输出相同），libdxfrw 路径还会逐个打印图元
+};
+
+// 一个做好的 group：三角形顶点三个一组，顶/底面在前、侧面在后，与 exportGroupToOBJ 的输入相同
+struct GroupMesh
+{
+    size_t index = 0;
+    std::string layer; // 外环所在图层
+    std::vector<Vertex> triangles;
+    CapFallback fallback = CapFallback::None;
+};
+
+enum class ConvertStage
+{
+    Reading,
+    Union,
+    Grouping,
+    Meshing
+};
+
+struct ConvertProgress
+{
+    ConvertStage stage;
+    size_t done;  // 读取、合并、分组阶段只有开始（0）与结束（1）两次回调
+    size_t total; // Meshing 阶段为 group 总数
+};
+
+// 回调都在调用 convert* 的线程上执行。onGroup 返回后网格即归调用方所有，
+// 可以直接 std::move 进自己的缓冲区或写出队列
+struct ConvertCallbacks
+{
+    std::function<void(GroupMesh &&)> onGroup;
+    std::function<void(const ConvertProgress &)> onProgress; // 可为空
+    std::function<bool()> cancelled;                         // 可为空；返回 true 时在下一个检查点停止
+};
+
+enum class ConvertStatus
+{
+    Ok,
+    ReadFailed,
+    Cancelled
+};
+const char *convertStatusName(ConvertStatus s);
+
+// 干跑：与 convertCadFile 相同地读取、分组与筛选 group，但不三角化、不写文件，只估算转换所需的容量。
+// output 为将要使用的输出设置（压缩等级、是否优化网格）；estimate.writerBytes 留给调用方按写出方式填写
+ConvertStatus estimateCadFile(const std::string &filename, const ConvertOptions &options, const OutputOptions &output,
+                              CapacityEstimate &estimate, RunReport *report = nullptr);
+
+// 图纸的 x/y 范围，供分片划分格子。ASCII DXF 先取 HEADER 中的 $EXTMIN/$EXTMAX，
+// 缺失或无效时（以及 DWG、二进制 DXF）读取全部图元求包围盒
+bool readCadExtents(const std::string &filename, const ConvertOptions &options, Bounds &extent);
+
+// report 非空时填入多边形数、group 数、三角形数、退化的 group 等；输出相关的字段由调用方负责
+ConvertStatus convertCadFile(const std::string &filename, const ConvertOptions &options,
+                             const ConvertCallbacks &callbacks, RunReport *report = nullptr);
+// 内存中的文件内容。ASCII DXF 直接解码；二进制 DXF、DWG 以及快速读取器不支持的内容
+// 需要 libdxfrw，而它只能读文件，此时先写到临时文件再读
+ConvertStatus convertCadBuffer(const char *data, size_t size, const ConvertOptions &options,
+                               const ConvertCallbacks &callbacks, RunReport *report = nullptr);
@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "output_sink.h"
+#include "shared_walls.h"
+#include "utils.h"
+
+// 一种输出格式的总字节数：rawBytes 为 OBJ 文本，storedBytes 为落盘字节（压缩格式按样本实测的压缩率折算）
+struct FormatEstimate
+{
+    std::string name;
+    uint64_t rawBytes = 0;
+    uint64_t storedBytes = 0;
+    bool available = true; // 构建时没有对应的压缩库时为 false
+};
+
+// 干跑（不三角化、不写文件）的容量估算，全部由 polys 中的环大小与分组结果推出。
+// 每个 group 的顶/底面各 n + 2h - 2 个三角形（n 为各环顶点总数，h 为洞数），每条边两个侧面三角形；
+// 对处于一般位置的环（互不相交，无重复点与共线点）是精确的；earcut 桥接洞后剔除的共线点会使实际数略少，
+// 三角化超出预算而退化、裁剪到区域的 group 按未退化、未裁剪计。
+// 内存与字节数为估算：顶/底面顶点的文本长度按环上顶点的平均值计，压缩率按样本实测
+struct CapacityEstimate
+{
+    uint64_t fileBytes = 0;
+    size_t polygons = 0;
+    size_t vertices = 0;
+    size_t groups = 0;
+    size_t holes = 0;
+    uint64_t capTriangles = 0;
+    uint64_t sideTriangles = 0;       // 已扣除剔除的共用墙
+    uint64_t culledWallTriangles = 0;
+    uint64_t weldedVertices = 0;      // 焊接成索引网格后的顶点数（--optimize-mesh）
+    uint64_t largestGroupTriangles = 0;
+    // 峰值内存的组成（字节）
+    uint64_t inputBytes = 0;    // 快速读取器映射的输入文件
+    uint64_t polygonBytes = 0;  // polys、分组结果与共用墙标记
+    uint64_t sweepBytes = 0;    // 包含关系扫描的边、事件与状态，分组结束即释放
+    uint64_t meshBytes = 0;     // 最大的一个 group 的网格与三角化工作区
+    uint64_t writerBytes = 0;   // 写出队列中尚未落盘的网格，由调用方按写出方式填写
+    std::vector<FormatEstimate> formats;
+    double elapsedSeconds = 0; // 读取与分组的实际耗时
+
+    uint64_t triangles() const { return capTriangles + sideTriangles; }
+    uint64_t soupVertices() const { return 3 * triangles(); } // 按三角形汤写出的顶点数
+    uint64_t peakMemory() const;
+    void print(std::ostream &os) const;
+};
+
+// walls 为空表示不剔除共用墙。output 的压缩等级用于实测压缩率，optimizeMesh 时网格内存计入索引网格
+CapacityEstimate estimateCapacity(const std::vector<RawPoly> &polys, const PolyGrouping &grouping, const SharedWalls *walls,
+                                  float height, const OutputOptions &output);
@@ -0,0 +1,20 @@
+﻿#pragma once
+#include <vector>
+#include "utils.h"
+
+// 多边形包含关系树：parent[i] 为直接包含多边形 i 的最小多边形（-1 表示最外层），
+// depth[i] 为嵌套深度。偶数深度是外环，奇数深度是洞，洞里的岛又回到偶数深度
+struct ContainmentTree
+{
+    std::vector<int> parent;
+    std::vector<int> depth;
+};
+
+// 平面扫描构建包含树，O(n log n)，n 为总顶点数。
+// 要求多边形之间互不相交（可以嵌套），以每个多边形最左侧顶点向上的射线判定其所在区域。
+// role 不是 Free 的环（HATCH 边界）不参与判定，也不会成为别人的父级，深度记为 0。
+// shape 为 Convex/Circle 的环拆成上下两条链整体进入扫描，不逐边插入。
+// 点与边的上下关系用精确的 orient2d 判定；在最左顶点处与查询多边形重合的多边形（叠放的副本）视为同层
+// threads > 1 时按 x 把扫描切成多段，由线程池按段领取并行处理（每段先放入跨过段起点的边），
+// 结果与单线程完全相同；0 表示使用全部硬件线程
+ContainmentTree buildContainmentTree(const std::vector<RawPoly> &polys, unsigned threads = 1);
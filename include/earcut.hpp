@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
@@ -10,6 +11,17 @@
 #include <utility>
 #include <vector>
 
+#include "predicates.h"
+
+// batched point-in-triangle tests: 4 doubles per op with AVX, two 2-lane ops with SSE2, scalar loop otherwise
+#if defined(__AVX__)
+#include <immintrin.h>
+#define EARCUT_SIMD_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EARCUT_SIMD_SSE2 1
+#endif
+
 namespace mapbox
 {
 
@@ -34,10 +46,34 @@ namespace mapbox
             std::vector<N> indices;
             std::size_t vertices = 0;
 
+            // work budget: maxIterations caps the number of ear/diagonal candidate tests, maxMillis the
+            // wall time (0 = unlimited). When exceeded the run stops early, aborted is set and indices
+            // only hold a partial result
+            std::size_t maxIterations = 0;
+            double maxMillis = 0;
+            std::size_t iterations = 0;
+            bool aborted = false;
+            bool timedOut = false;
+
+            // with at least this many holes, bridge search uses a grid index over the merged outer ring
+            // instead of walking the whole ring for every hole
+            std::size_t holeIndexThreshold = 16;
+
+            // rings with more than this many vertices in total use z-order hashing for ear tests
+            std::size_t hashThreshold = 80;
+            // hashed rings with at least this many vertices scan z-sorted coordinate arrays earBatch points at a
+            // time with SIMD instead of walking the z-order list (max = never); the result is identical to the
+            // one-point-at-a-time path. Below it the few candidates per ear don't pay for building the arrays
+            std::size_t simdEarThreshold = 10000;
+            static constexpr std::size_t earBatch = 4;
+
             template <typename Polygon>
             void operator()(const Polygon &points);
 
         private:
+            bool overBudget();
+            std::chrono::steady_clock::time_point startTime;
+
             struct Node
             {
                 Node(N index, double x_, double y_) : x(x_), y(y_), i(index), steiner(0) {}
@@ -56,6 +92,9 @@ namespace mapbox
                 // z-order curve value
                 int32_t z = 0;
 
+                // position in the z-sorted arrays (-1 = not indexed)
+                int32_t slot = -1;
+
                 // original index in polygon
                 const N i : (sizeof(N) * 8 - 1);
 
@@ -77,18 +116,92 @@ namespace mapbox
                 Triangle(const Node *a, const Node *b, const Node *c)
                     : ax(a->x), ay(a->y), bx(b->x), by(b->y), cx(c->x), cy(c->y) {}
 
-                inline double area() const { return (by - ay) * (cx - bx) - (bx - ax) * (cy - by); }
+                // signs come from the adaptive orient2d, so they are exact for collinear and near-collinear input
+                inline double area() const { return -orient2d(ax, ay, bx, by, cx, cy); }
 
                 inline bool containsPoint(double px, double py) const
                 {
-                    return (cx - px) * (ay - py) >= (ax - px) * (cy - py) && (ax - px) * (by - py) >= (bx - px) * (ay - py) &&
-                           (bx - px) * (cy - py) >= (cx - px) * (by - py);
+                    return orient2d(cx, cy, ax, ay, px, py) >= 0 && orient2d(ax, ay, bx, by, px, py) >= 0 &&
+                           orient2d(bx, by, cx, cy, px, py) >= 0;
+                }
+
+                // containsPoint for earBatch points at once; bit k of the result is set when point k is inside.
+                // Runs the orient2d floating-point filter on all lanes; lanes where some edge test is within the
+                // error bound (and no edge is certainly negative) are re-checked with the exact scalar path, so
+                // each bit matches containsPoint exactly
+                inline unsigned containsPoints(const double *px, const double *py) const
+                {
+#if defined(EARCUT_SIMD_AVX)
+                    const __m256d x = _mm256_loadu_pd(px), y = _mm256_loadu_pd(py);
+                    const __m256d dax = _mm256_sub_pd(_mm256_set1_pd(ax), x), day = _mm256_sub_pd(_mm256_set1_pd(ay), y);
+                    const __m256d dbx = _mm256_sub_pd(_mm256_set1_pd(bx), x), dby = _mm256_sub_pd(_mm256_set1_pd(by), y);
+                    const __m256d dcx = _mm256_sub_pd(_mm256_set1_pd(cx), x), dcy = _mm256_sub_pd(_mm256_set1_pd(cy), y);
+                    const __m256d bound = _mm256_set1_pd(kOrient2dErrBound), absMask = _mm256_set1_pd(-0.0);
+                    __m256d ge = _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), unsure = _mm256_setzero_pd();
+                    const auto edge = [&](__m256d l, __m256d r)
+                    {
+                        const __m256d det = _mm256_sub_pd(l, r);
+                        const __m256d sum = _mm256_add_pd(_mm256_andnot_pd(absMask, l), _mm256_andnot_pd(absMask, r));
+                        const __m256d u = _mm256_cmp_pd(_mm256_andnot_pd(absMask, det), _mm256_mul_pd(bound, sum), _CMP_LT_OQ);
+                        ge = _mm256_and_pd(ge, _mm256_or_pd(_mm256_cmp_pd(det, _mm256_setzero_pd(), _CMP_GE_OQ), u));
+                        unsure = _mm256_or_pd(unsure, u);
+                    };
+                    edge(_mm256_mul_pd(dcx, day), _mm256_mul_pd(dax, dcy));
+                    edge(_mm256_mul_pd(dax, dby), _mm256_mul_pd(dbx, day));
+                    edge(_mm256_mul_pd(dbx, dcy), _mm256_mul_pd(dcx, dby));
+                    unsigned mask = unsigned(_mm256_movemask_pd(ge));
+                    unsigned recheck = mask & unsigned(_mm256_movemask_pd(unsure));
+                    for (unsigned k = 0; recheck; k++, recheck >>= 1)
+                    {
+                        if ((recheck & 1u) && !containsPoint(px[k], py[k]))
+                            mask &= ~(1u << k);
+                    }
+                    return mask;
+#elif defined(EARCUT_SIMD_SSE2)
+                    unsigned mask = 0, recheck = 0;
+                    const __m128d bound = _mm_set1_pd(kOrient2dErrBound), absMask = _mm_set1_pd(-0.0);
+                    for (std::size_t k = 0; k < earBatch; k += 2)
+                    {
+                        const __m128d x = _mm_loadu_pd(px + k), y = _mm_loadu_pd(py + k);
+                        const __m128d dax = _mm_sub_pd(_mm_set1_pd(ax), x), day = _mm_sub_pd(_mm_set1_pd(ay), y);
+                        const __m128d dbx = _mm_sub_pd(_mm_set1_pd(bx), x), dby = _mm_sub_pd(_mm_set1_pd(by), y);
+                        const __m128d dcx = _mm_sub_pd(_mm_set1_pd(cx), x), dcy = _mm_sub_pd(_mm_set1_pd(cy), y);
+                        __m128d ge = _mm_castsi128_pd(_mm_set1_epi32(-1)), unsure = _mm_setzero_pd();
+                        const auto edge = [&](__m128d l, __m128d r)
+                        {
+                            const __m128d det = _mm_sub_pd(l, r);
+                            const __m128d sum = _mm_add_pd(_mm_andnot_pd(absMask, l), _mm_andnot_pd(absMask, r));
+                            const __m128d u = _mm_cmplt_pd(_mm_andnot_pd(absMask, det), _mm_mul_pd(bound, sum));
+                            ge = _mm_and_pd(ge, _mm_or_pd(_mm_cmpge_pd(det, _mm_setzero_pd()), u));
+                            unsure = _mm_or_pd(unsure, u);
+                        };
+                        edge(_mm_mul_pd(dcx, day), _mm_mul_pd(dax, dcy));
+                        edge(_mm_mul_pd(dax, dby), _mm_mul_pd(dbx, day));
+                        edge(_mm_mul_pd(dbx, dcy), _mm_mul_pd(dcx, dby));
+                        const unsigned m = unsigned(_mm_movemask_pd(ge));
+                        mask |= m << k;
+                        recheck |= (m & unsigned(_mm_movemask_pd(unsure))) << k;
+                    }
+                    for (unsigned k = 0; recheck; k++, recheck >>= 1)
+                    {
+                        if ((recheck & 1u) && !containsPoint(px[k], py[k]))
+                            mask &= ~(1u << k);
+                    }
+                    return mask;
+#else
+                    unsigned mask = 0;
+                    for (std::size_t k = 0; k < earBatch; k++)
+                        mask |= unsigned(containsPoint(px[k], py[k])) << k;
+                    return mask;
+#endif
                 }
             };
 
+
             template <typename Ring>
             Node *linkedList(const Ring &points, const bool clockwise);
             Node *filterPoints(Node *start, Node *end = nullptr);
+            Node *filterPointsLocal(Node *start, Node *end);
             void earcutLinked(Node *ear, int pass = 0);
             bool isEar(Node *ear);
             bool isEarHashed(Node *ear);
@@ -98,6 +211,7 @@ namespace mapbox
             Node *eliminateHoles(const Polygon &points, Node *outerNode);
             Node *eliminateHole(Node *hole, Node *outerNode);
             Node *findHoleBridge(Node *hole, Node *outerNode);
+            Node *findHoleBridgeIndexed(Node *hole);
             bool sectorContainsSector(const Node *m, const Node *p);
             void indexCurve(Node *start);
             Node *sortLinked(Node *list);
@@ -211,8 +325,88 @@ namespace mapbox
                 }
             };
 
+            // uniform grid of outer ring edges (node p stands for edge p -> p->next), registered over the edge bbox;
+            // entries go stale when nodes are removed or relinked, so every lookup re-validates the node
+            struct EdgeGrid
+            {
+                double minX = 0, minY = 0;
+                double invW = 0, invH = 0;
+                int cols = 1, rows = 1;
+                std::vector<std::vector<Node *>> cells;
+
+                void reset(double x0, double y0, double x1, double y1, std::size_t nodeCount)
+                {
+                    std::size_t target = std::max<std::size_t>(1, nodeCount / 2);
+                    double w = x1 - x0, h = y1 - y0;
+                    double cell = (w > 0 && h > 0) ? std::sqrt(w * h / double(target)) : std::max(w, h) / double(target);
+                    cols = cell > 0 ? std::max(1, std::min(4096, int(w / cell) + 1)) : 1;
+                    rows = cell > 0 ? std::max(1, std::min(4096, int(h / cell) + 1)) : 1;
+                    minX = x0;
+                    minY = y0;
+                    invW = w > 0 ? cols / w : 0;
+                    invH = h > 0 ? rows / h : 0;
+                    cells.assign(std::size_t(cols) * rows, {});
+                }
+                void clear() { cells.clear(); }
+                int col(double x) const { return std::max(0, std::min(cols - 1, int((x - minX) * invW))); }
+                int row(double y) const { return std::max(0, std::min(rows - 1, int((y - minY) * invH))); }
+                std::vector<Node *> &cell(int c, int r) { return cells[std::size_t(r) * cols + c]; }
+                void insert(Node *p)
+                {
+                    const Node *q = p->next;
+                    int c0 = col(std::min(p->x, q->x)), c1 = col(std::max(p->x, q->x));
+                    int r0 = row(std::min(p->y, q->y)), r1 = row(std::max(p->y, q->y));
+                    for (int r = r0; r <= r1; r++)
+                        for (int c = c0; c <= c1; c++)
+                            cell(c, r).push_back(p);
+                }
+            };
+
+            // structure-of-arrays copy of the z-order list built by indexCurve, padded with earBatch NaN slots
+            // so the last batch can always load a full register
+            struct ZSorted
+            {
+                std::vector<int32_t> z;
+                std::vector<double> x, y;
+                std::vector<const Node *> nodes;
+                std::size_t count = 0;
+                std::size_t dead = 0;
+
+                void build(Node *head, std::size_t n)
+                {
+                    dead = 0;
+                    const double nan = std::numeric_limits<double>::quiet_NaN();
+                    z.assign(n, 0);
+                    x.assign(n + earBatch, nan);
+                    y.assign(n + earBatch, nan);
+                    nodes.assign(n, nullptr);
+                    count = 0;
+                    for (Node *p = head; p; p = p->nextZ)
+                    {
+                        p->slot = int32_t(count);
+                        z[count] = p->z;
+                        x[count] = p->x;
+                        y[count] = p->y;
+                        nodes[count++] = p;
+                    }
+                }
+                void remove(const Node *p)
+                {
+                    if (p->slot >= 0 && std::size_t(p->slot) < count && nodes[p->slot] == p)
+                    {
+                        x[p->slot] = y[p->slot] = std::numeric_limits<double>::quiet_NaN();
+                        nodes[p->slot] = nullptr;
+                        dead++;
+                    }
+                }
+            };
+
             std::unique_ptr<ObjectPool<Node>> nodes;
             std::vector<Node *> holeQueue;
+            ZSorted zSorted;
+            bool useZSorted = false;
+            EdgeGrid bridgeGrid;
+            bool useBridgeGrid = false;
         };
 
         template <typename N>
@@ -222,20 +416,22 @@ namespace mapbox
             // reset
             indices.clear();
             vertices = 0;
+            iterations = 0;
+            aborted = false;
+            timedOut = false;
+            useZSorted = false;
+            if (maxMillis > 0)
+                startTime = std::chrono::steady_clock::now();
 
             if (points.empty())
                 return;
 
             double x;
             double y;
-            int threshold = 80;
             std::size_t len = 0;
 
-            for (size_t i = 0; threshold >= 0 && i < points.size(); i++)
-            {
-                threshold -= static_cast<int>(points[i].size());
+            for (size_t i = 0; i < points.size(); i++)
                 len += points[i].size();
-            }
 
             // estimate size of nodes and indices
             if (!nodes)
@@ -253,7 +449,7 @@ namespace mapbox
                 outerNode = eliminateHoles(points, outerNode);
 
             // if the shape is not too simple, we'll use z-order curve hash later; calculate polygon bbox
-            hashing = threshold < 0;
+            hashing = len > hashThreshold;
             if (hashing)
             {
                 Node *p = outerNode->next;
@@ -275,12 +471,31 @@ namespace mapbox
                 inv_size = inv_size != .0 ? (32767. / inv_size) : .0;
             }
 
-            earcutLinked(outerNode);
+            if (!aborted)
+                earcutLinked(outerNode);
 
             nodes->clear();
             holeQueue.clear();
         }
 
+        // count one unit of work and check it against the budget; the clock is only read every 1024 units
+        template <typename N>
+        bool Earcut<N>::overBudget()
+        {
+            if (aborted)
+                return true;
+            ++iterations;
+            if (maxIterations && iterations > maxIterations)
+                aborted = true;
+            else if (maxMillis > 0 && (iterations & 1023) == 0)
+            {
+                double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+                if (elapsed > maxMillis)
+                    aborted = timedOut = true;
+            }
+            return aborted;
+        }
+
         // create a circular doubly linked list from polygon points in the specified winding order
         template <typename N>
         template <typename Ring>
@@ -358,6 +573,31 @@ namespace mapbox
             return end;
         }
 
+        // eliminate colinear or duplicate points from start to end only; after a removal the previous node
+        // is re-checked instead of restarting a pass over the whole ring
+        template <typename N>
+        typename Earcut<N>::Node *Earcut<N>::filterPointsLocal(Node *start, Node *end)
+        {
+            Node *stop = end->next;
+            Node *p = start;
+            while (p != stop)
+            {
+                if (!p->steiner && (equals(p, p->next) || area(p->prev, p, p->next) == 0))
+                {
+                    Node *prev = p->prev;
+                    removeNode(p);
+                    if (prev == prev->next)
+                        return prev;
+                    p = prev;
+                }
+                else
+                {
+                    p = p->next;
+                }
+            }
+            return stop->prev;
+        }
+
         // main ear slicing loop which triangulates a polygon (given as a linked list)
         template <typename N>
         void Earcut<N>::earcutLinked(Node *ear, int pass)
@@ -376,6 +616,9 @@ namespace mapbox
             // iterate through ears, slicing them one by one
             while (ear->prev != ear->next)
             {
+                if (overBudget())
+                    return;
+
                 prev = ear->prev;
                 next = ear->next;
 
@@ -468,6 +711,43 @@ namespace mapbox
             const int32_t minZ = zOrder(minTX, minTY);
             const int32_t maxZ = zOrder(maxTX, maxTY);
 
+            // the nodes walked below are exactly the z-sorted slots in [minZ, maxZ]; scan them contiguously,
+            // earBatch points per test. Removed nodes hold NaN coordinates and never test as inside
+            if (useZSorted)
+            {
+                // drop removed slots once they make up a quarter of the arrays, so scans stay proportional to
+                // the live ring
+                if (zSorted.dead * 4 > zSorted.count)
+                {
+                    Node *head = ear;
+                    while (head->prevZ)
+                        head = head->prevZ;
+                    zSorted.build(head, zSorted.count - zSorted.dead);
+                }
+                // the ear's own slot lies inside the range; extend from it like the list walks do
+                const int32_t *z = zSorted.z.data();
+                std::size_t lo = std::size_t(ear->slot), hi = lo + 1;
+                while (lo > 0 && z[lo - 1] >= minZ)
+                    lo--;
+                while (hi < zSorted.count && z[hi] <= maxZ)
+                    hi++;
+                for (std::size_t k = lo; k < hi; k += earBatch)
+                {
+                    unsigned mask = tri.containsPoints(zSorted.x.data() + k, zSorted.y.data() + k);
+                    if (hi - k < earBatch)
+                        mask &= (1u << (hi - k)) - 1;
+                    for (std::size_t lane = 0; mask; lane++, mask >>= 1)
+                    {
+                        if (!(mask & 1u))
+                            continue;
+                        const Node *p = zSorted.nodes[k + lane];
+                        if (p != ear && p != ear->prev && p != ear->next && area(p->prev, p, p->next) >= 0)
+                            return false;
+                    }
+                }
+                return true;
+            }
+
             // first look for points inside the triangle in increasing z-order
             Node *p = ear->nextZ;
 
@@ -531,6 +811,8 @@ namespace mapbox
                 Node *b = a->next->next;
                 while (b != a->prev)
                 {
+                    if (overBudget())
+                        return;
                     if (a->i != b->i && isValidDiagonal(a, b))
                     {
                         // split the polygon in two by the diagonal
@@ -572,12 +854,48 @@ namespace mapbox
             std::sort(holeQueue.begin(), holeQueue.end(), [](const Node *a, const Node *b)
                       { return a->x < b->x; });
 
+            // many holes: index the outer ring so each bridge search only visits nearby edges
+            useBridgeGrid = holeQueue.size() >= holeIndexThreshold;
+            if (useBridgeGrid)
+            {
+                double x0 = outerNode->x, y0 = outerNode->y, x1 = x0, y1 = y0;
+                std::size_t count = 0;
+                auto extend = [&](Node *start)
+                {
+                    Node *p = start;
+                    do
+                    {
+                        x0 = std::min<double>(x0, p->x);
+                        y0 = std::min<double>(y0, p->y);
+                        x1 = std::max<double>(x1, p->x);
+                        y1 = std::max<double>(y1, p->y);
+                        count++;
+                        p = p->next;
+                    } while (p != start);
+                };
+                extend(outerNode);
+                for (Node *hole : holeQueue)
+                    extend(hole);
+                bridgeGrid.reset(x0, y0, x1, y1, count);
+
+                Node *p = outerNode;
+                do
+                {
+                    bridgeGrid.insert(p);
+                    p = p->next;
+                } while (p != outerNode);
+            }
+
             // process holes from left to right
             for (size_t i = 0; i < holeQueue.size(); i++)
             {
+                if (overBudget())
+                    break;
                 outerNode = eliminateHole(holeQueue[i], outerNode);
             }
 
+            useBridgeGrid = false;
+            bridgeGrid.clear();
             return outerNode;
         }
 
@@ -593,7 +911,26 @@ namespace mapbox
 
             Node *bridgeReverse = splitPolygon(bridge, hole);
 
-            // filter collinear points around the cuts
+            // the hole is now part of the outer ring: index its edges and the two bridge edges
+            if (useBridgeGrid)
+            {
+                Node *stop = bridgeReverse->next;
+                Node *p = bridge;
+                do
+                {
+                    bridgeGrid.insert(p);
+                    p = p->next;
+                } while (p != stop);
+                bridgeGrid.insert(stop);
+            }
+
+            // filter collinear points around the cuts; with many holes only the cut neighbourhood is
+            // re-checked, a full ring pass per hole would bring back the O(h*n) cost
+            if (useBridgeGrid)
+            {
+                filterPointsLocal(bridgeReverse, bridgeReverse->next);
+                return filterPointsLocal(bridge, bridge->next);
+            }
             filterPoints(bridgeReverse, bridgeReverse->next);
 
             // Check if input node was removed by the filtering
@@ -604,6 +941,9 @@ namespace mapbox
         template <typename N>
         typename Earcut<N>::Node *Earcut<N>::findHoleBridge(Node *hole, Node *outerNode)
         {
+            if (useBridgeGrid)
+                return findHoleBridgeIndexed(hole);
+
             Node *p = outerNode;
             double hx = hole->x;
             double hy = hole->y;
@@ -664,6 +1004,84 @@ namespace mapbox
             return m;
         }
 
+        // same as findHoleBridge, but only visits outer ring edges registered in grid cells near the hole
+        template <typename N>
+        typename Earcut<N>::Node *Earcut<N>::findHoleBridgeIndexed(Node *hole)
+        {
+            // a removed node keeps its links, but its neighbours no longer point back at it
+            auto alive = [](const Node *p)
+            { return p->prev->next == p && p->next->prev == p; };
+
+            double hx = hole->x;
+            double hy = hole->y;
+            double qx = -std::numeric_limits<double>::infinity();
+            Node *m = nullptr;
+
+            // cast the ray to the left cell by cell; once a hit lies in the current column nothing further
+            // left can beat it
+            const int r = bridgeGrid.row(hy);
+            for (int c = bridgeGrid.col(hx); c >= 0; c--)
+            {
+                for (Node *p : bridgeGrid.cell(c, r))
+                {
+                    if (!alive(p))
+                        continue;
+                    if (hy <= p->y && hy >= p->next->y && p->next->y != p->y)
+                    {
+                        double x = p->x + (hy - p->y) * (p->next->x - p->x) / (p->next->y - p->y);
+                        if (x <= hx && x > qx)
+                        {
+                            qx = x;
+                            m = p->x < p->next->x ? p : p->next;
+                            if (x == hx)
+                                return m; // hole touches outer segment; pick leftmost endpoint
+                        }
+                    }
+                }
+                if (m && bridgeGrid.col(qx) >= c)
+                    break;
+            }
+
+            if (!m)
+                return 0;
+
+            // look for points inside the triangle of hole Vertex, segment intersection and endpoint
+            double tanMin = std::numeric_limits<double>::infinity();
+            double tanCur = 0;
+
+            const double mx = m->x;
+            const double my = m->y;
+            const int c0 = bridgeGrid.col(mx), c1 = bridgeGrid.col(hx);
+            const int r0 = bridgeGrid.row(std::min(hy, my)), r1 = bridgeGrid.row(std::max(hy, my));
+
+            for (int rr = r0; rr <= r1; rr++)
+            {
+                for (int cc = c0; cc <= c1; cc++)
+                {
+                    for (Node *p : bridgeGrid.cell(cc, rr))
+                    {
+                        // a node is registered in every cell of its edge bbox; only test it in its own cell
+                        if (bridgeGrid.col(p->x) != cc || bridgeGrid.row(p->y) != rr || !alive(p))
+                            continue;
+                        if (hx >= p->x && p->x >= mx && hx != p->x &&
+                            pointInTriangle(hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy, p->x, p->y))
+                        {
+                            tanCur = std::abs(hy - p->y) / (hx - p->x); // tangential
+
+                            if (locallyInside(p, hole) &&
+                                (tanCur < tanMin || (tanCur == tanMin && (p->x > m->x || sectorContainsSector(m, p)))))
+                            {
+                                m = p;
+                                tanMin = tanCur;
+                            }
+                        }
+                    }
+                }
+            }
+
+            return m;
+        }
+
         // whether sector in vertex m contains sector in vertex p in the same coordinates
         template <typename N>
         bool Earcut<N>::sectorContainsSector(const Node *m, const Node *p)
@@ -677,6 +1095,7 @@ namespace mapbox
         {
             assert(start);
             Node *p = start;
+            std::size_t n = 0;
 
             do
             {
@@ -684,12 +1103,16 @@ namespace mapbox
                 p->prevZ = p->prev;
                 p->nextZ = p->next;
                 p = p->next;
+                n++;
             } while (p != start);
 
             p->prevZ->nextZ = nullptr;
             p->prevZ = nullptr;
 
-            sortLinked(p);
+            Node *head = sortLinked(p);
+            useZSorted = n >= simdEarThreshold;
+            if (useZSorted)
+                zSorted.build(head, n);
         }
 
         // Simon Tatham's linked list merge sort algorithm
@@ -817,8 +1240,8 @@ namespace mapbox
         bool Earcut<N>::pointInTriangle(
             double ax, double ay, double bx, double by, double cx, double cy, double px, double py) const
         {
-            return (cx - px) * (ay - py) >= (ax - px) * (cy - py) && (ax - px) * (by - py) >= (bx - px) * (ay - py) &&
-                   (bx - px) * (cy - py) >= (cx - px) * (by - py);
+            return orient2d(cx, cy, ax, ay, px, py) >= 0 && orient2d(ax, ay, bx, by, px, py) >= 0 &&
+                   orient2d(bx, by, cx, cy, px, py) >= 0;
         }
 
         // check if a diagonal between two polygon nodes is valid (lies in polygon interior)
@@ -833,11 +1256,12 @@ namespace mapbox
                      area(b->prev, b, b->next) > 0)); // special zero-length case
         }
 
-        // signed area of a triangle
+        // signed area of a triangle (negative when p, q, r are counter-clockwise); the sign is exact, so the
+        // collinearity checks below and in intersects/locallyInside hold for near-degenerate input too
         template <typename N>
         double Earcut<N>::area(const Node *p, const Node *q, const Node *r) const
         {
-            return (q->y - p->y) * (r->x - q->x) - (q->x - p->x) * (r->y - q->y);
+            return -orient2d(p->x, p->y, q->x, q->y, r->x, r->y);
         }
 
         // check if two points are equal
@@ -982,6 +1406,13 @@ namespace mapbox
             p->next->prev = p->prev;
             p->prev->next = p->next;
 
+            // the previous node's edge now reaches further; register its new extent
+            if (useBridgeGrid)
+                bridgeGrid.insert(p->prev);
+
+            if (useZSorted)
+                zSorted.remove(p);
+
             if (p->prevZ)
                 p->prevZ->nextZ = p->nextZ;
             if (p->nextZ)
@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include "region.h"
+#include "utils.h"
+
+// 只读内存映射文件，映射失败时 data() 为 nullptr
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &filename);
+    void close();
+
+    const char *data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    const char *_data = nullptr;
+    size_t _size = 0;
+#ifdef _WIN32
+    void *_file = nullptr;
+    void *_mapping = nullptr;
+#endif
+};
+
+// 一个 DXF 组：组码 + 值，值直接指向映射内存，不做拷贝
+struct DxfGroup
+{
+    int code = -1;
+    std::string_view value;
+};
+
+// ASCII DXF 的组码/值逐行扫描器
+class DxfTokenizer
+{
+public:
+    DxfTokenizer(const char *begin, const char *end) : _cur(begin), _end(end) {}
+
+    // 读取下一组，文件结束或格式错误时返回 false
+    bool next(DxfGroup &g);
+    // 把组值解析为浮点数，解析失败时置错误标记
+    double toDouble(const DxfGroup &g);
+
+    const char *position() const { return _cur; }
+    bool failed() const { return _failed; }
+
+private:
+    bool readLine(std::string_view &line);
+
+    const char *_cur;
+    const char *_end;
+    bool _failed = false;
+};
+
+// 直接扫描 ENTITIES 段，把 LWPOLYLINE、CIRCLE 与 HATCH 边界解码进 out（追加）。
+// 返回 false 表示遇到了快速路径不处理的内容（二进制 DXF、块定义里的图元、格式错误等），
+// 此时 out 保持不变，调用方应回退到 dxfRW::read。
+// threads > 1 时 ENTITIES 段按图元边界切块并行解码，结果顺序与串行一致；threads == 0 表示使用全部硬件线程。
+// region 非空时包围盒与区域不相交的图元解码后直接丢弃
+bool readDxfFast(const std::string &filename, std::vector<RawPoly> &out, unsigned threads = 1,
+                 const Region *region = nullptr);
+// 同上，直接解码内存中的文件内容，调用期间 data 必须保持有效
+bool readDxfFastBuffer(const char *data, size_t size, std::vector<RawPoly> &out, unsigned threads = 1,
+                       const Region *region = nullptr);
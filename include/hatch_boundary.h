@@ -0,0 +1,25 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include "utils.h"
+
+// HATCH 边界环的拼接。边界由若干段首尾相接的边组成（直线、圆弧、椭圆弧），
+// 或者是一条带凸度的多段线；角度均为弧度，圆弧按整圆 64 段的密度离散
+
+// 把一段已离散的边接到环尾：方向与环相反时倒过来接，与环尾重合的首点去掉
+void appendHatchEdge(std::vector<Vertex> &ring, std::vector<Vertex> &edge);
+
+void hatchLineEdge(std::vector<Vertex> &edge, double x0, double y0, double x1, double y1);
+// DXF 中顺时针圆弧的起止角按镜像存放，ccw == false 时取负后顺时针扫过
+void hatchArcEdge(std::vector<Vertex> &edge, double cx, double cy, double r,
+                  double start, double end, bool ccw);
+// (mx, my) 为长轴端点相对圆心的向量，ratio 为短轴与长轴之比，start/end 为相对长轴的角度
+void hatchEllipseEdge(std::vector<Vertex> &edge, double cx, double cy, double mx, double my,
+                      double ratio, double start, double end, bool ccw);
+// 多段线边界的一段：bulge 为 0 时是直线，否则为圆弧（bulge = tan(圆心角 / 4)），只追加起点和中间点
+void appendBulgeSegment(std::vector<Vertex> &ring, double x0, double y0, double x1, double y1, double bulge);
+
+// 一个 HATCH 的全部边界环按“外环 + 其洞”的顺序追加到 out，并标记 RingRole。
+// 只有一个环时直接作为外环；多个环时只在本 HATCH 的环之间判定嵌套，不与其它图元比较
+void appendHatchLoops(std::vector<std::vector<Vertex>> &loops, const std::string &layer,
+                      std::vector<RawPoly> &out);
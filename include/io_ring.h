@@ -0,0 +1,28 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// io_uring 写文件：write 把数据拷进自有缓冲后立即提交，不等待完成，close 时才等该文件的写请求全部落盘。
+// 只在 Linux 且构建时找到 liburing（CADPROC_HAVE_LIBURING）时可用，否则 create 返回空，调用方改用阻塞写
+class IoRing
+{
+public:
+    // entries 同时也是在途写请求的上限，达到上限时 write 先回收已完成的请求
+    static std::unique_ptr<IoRing> create(unsigned entries = 64);
+    ~IoRing();
+    IoRing(const IoRing &) = delete;
+    IoRing &operator=(const IoRing &) = delete;
+
+    // 打开（截断或新建）文件，失败返回 -1
+    int open(const std::string &path);
+    bool write(int fd, const char *data, size_t size, uint64_t offset);
+    // 等待该文件的写请求全部完成后关闭，返回所有写入是否成功
+    bool close(int fd);
+
+    struct Impl;
+
+private:
+    explicit IoRing(std::unique_ptr<Impl> impl);
+    std::unique_ptr<Impl> impl;
+};
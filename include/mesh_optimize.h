@@ -0,0 +1,28 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "utils.h"
+
+// 导出前的网格优化：把三角形汤焊接成索引网格，按顶点缓存友好的顺序重排三角形（Forsyth），
+// 再按首次使用的顺序重排顶点，使 GPU 的变换后缓存与顶点读取都更连续
+
+// 统计 ACMR（平均每个三角形的缓存未命中次数）时模拟的 FIFO 缓存大小
+static const unsigned kAcmrCacheSize = 16;
+
+struct IndexedMesh
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices; // 三个一组，保持原三角形的绕向
+};
+
+// 坐标完全相同的顶点合并为一个，三角形顺序不变
+IndexedMesh buildIndexedMesh(const std::vector<Vertex> &triangles);
+// Forsyth 线性时间顶点缓存优化：每次输出评分最高的三角形，评分由其顶点在模拟 LRU 缓存中的位置
+// 与剩余未输出的相邻三角形数决定
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+// 按索引中首次出现的顺序重新编号顶点，未被引用的顶点被丢弃
+void optimizeVertexFetch(IndexedMesh &mesh);
+// 按大小为 cacheSize 的 FIFO 缓存模拟变换后缓存，返回未命中次数；除以三角形数即为 ACMR
+size_t simulateVertexCacheMisses(const std::vector<uint32_t> &indices, size_t vertexCount,
+                                 unsigned cacheSize = kAcmrCacheSize);
@@ -0,0 +1,9 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+#include "utils.h"
+
+// 基于扫描线的单调剖分三角化（de Berg《计算几何》第 3 章），O(n log n)。
+// rings[0] 为外环，其余为洞，顶点下标按各环依次拼接编号，与 earcut 的输出约定一致，三角形为逆时针。
+// 对重复点、自交等退化输入返回 false，调用方应回退到 earcut
+bool monotoneTriangulate(const RingList &rings, std::vector<uint32_t> &indices);
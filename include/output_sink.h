@@ -0,0 +1,79 @@
+﻿#pragma once
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+class IoRing;
+
+// 输出文件的压缩格式；Gzip 需要编译时找到 zlib，Zstd 需要 libzstd
+enum class OutputCompression
+{
+    None,
+    Gzip,
+    Zstd
+};
+
+bool outputCompressionAvailable(OutputCompression compression);
+// 压缩格式对应的文件后缀：""、".gz"、".zst"
+const char *outputCompressionSuffix(OutputCompression compression);
+
+struct OutputOptions
+{
+    OutputCompression compression = OutputCompression::None;
+    int level = 0; // 0 表示使用编码器的默认等级
+    IoRing *ring = nullptr; // 非空时经由 io_uring 写盘，不等待写完成
+    bool optimizeMesh = false; // 写出焊接后的索引网格，并按顶点缓存与读取顺序重排
+};
+
+// 所有输出文件的累计字节数
+struct OutputStats
+{
+    size_t files = 0;
+    uint64_t rawBytes = 0;    // 压缩前
+    uint64_t storedBytes = 0; // 实际写入磁盘
+    // optimizeMesh 时的顶点缓存统计（FIFO 模拟），用于计算优化前后的 ACMR
+    uint64_t meshTriangles = 0;
+    uint64_t cacheMissesBefore = 0;
+    uint64_t cacheMissesAfter = 0;
+};
+
+// 边写边压缩的输出流缓冲：写入的数据先攒进固定大小的块，块满后交给编码器并立即写盘，
+// 内存占用与文件大小无关。配合 std::ostream 使用，格式化结果与直接写文件完全相同
+class OutputSink : public std::streambuf
+{
+public:
+    OutputSink(const std::string &path, const OutputOptions &options);
+    ~OutputSink() override;
+    OutputSink(const OutputSink &) = delete;
+    OutputSink &operator=(const OutputSink &) = delete;
+
+    bool isOpen() const { return (ring ? fd >= 0 : file.is_open()) && !failed; }
+    // 刷出剩余数据并结束压缩流，返回整个文件是否写入成功
+    bool close();
+
+    uint64_t rawBytes() const { return raw; }
+    uint64_t storedBytes() const { return stored; }
+
+    struct Codec;
+
+protected:
+    int_type overflow(int_type ch) override;
+    int sync() override;
+
+private:
+    bool flushBlock(bool finish);
+
+    std::ofstream file;
+    IoRing *ring = nullptr;
+    int fd = -1;
+    std::unique_ptr<Codec> codec; // 为空表示不压缩
+    std::vector<char> block;
+    std::vector<char> packed;
+    uint64_t raw = 0;
+    uint64_t stored = 0;
+    bool failed = false;
+    bool closed = false;
+};
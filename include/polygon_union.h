@@ -0,0 +1,30 @@
+﻿#pragma once
+#include <vector>
+#include "utils.h"
+
+// 拉伸前的外轮廓合并（dissolve）：同一栋建筑常被拆成多条相互重叠或相接的多段线，
+// 合并后只生成一个实体，避免顶面 z-fighting 与重复的墙面
+enum class UnionMode
+{
+    Off,
+    Global,  // 所有图层一起合并
+    PerLayer // 只合并同一图层内的多边形
+};
+
+struct UnionStats
+{
+    size_t inputRings = 0;
+    size_t outputRings = 0;
+    size_t clusters = 0; // 包围盒相交、实际参与布尔运算的多边形簇
+};
+
+// 对 polys 做并集，结果替换 polys。按包围盒把多边形分成互不相交的簇，孤立的多边形原样保留；
+// 每个簇用扫描束（scanbeam）扫描线求非零环绕数并集，输出互不相交的环，洞仍由包含关系判定。
+// 簇内被奇数个环包住的环是洞，与之边界相交的环不算包住它，因此压到洞上的另一栋建筑会把洞填上。
+// 完全重合的重复环只保留一份
+void unionFootprints(std::vector<RawPoly> &polys, UnionMode mode, UnionStats *stats = nullptr);
+
+// 用同一套扫描束求一个 group（rings[0] 为外环，其余为洞）与区域 outline 的交集。
+// 结果可能分成几块，每块的第一个环为外环（逆时针），其后为洞（顺时针）。边界没能闭合时返回 false
+bool clipRingsToRegion(const RingList &rings, const std::vector<Vertex> &outline,
+                       std::vector<std::vector<std::vector<Vertex>>> &pieces);
@@ -0,0 +1,59 @@
+﻿#pragma once
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "utils.h"
+
+// 轴对齐包围盒，空盒的 min > max
+struct Bounds
+{
+    double minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+
+    void add(double x, double y)
+    {
+        minX = std::min(minX, x);
+        minY = std::min(minY, y);
+        maxX = std::max(maxX, x);
+        maxY = std::max(maxY, y);
+    }
+    bool empty() const { return minX > maxX; }
+    bool overlaps(const Bounds &o) const
+    {
+        return minX <= o.maxX && o.minX <= maxX && minY <= o.maxY && o.minY <= maxY;
+    }
+};
+
+Bounds boundsOfRing(const std::vector<Vertex> &ring);
+
+// 感兴趣区域（ROI）：矩形或任意简单多边形，只转换与之相交的图元。
+// 默认构造的区域不做任何限制
+class Region
+{
+public:
+    Region() = default;
+    static Region box(double minX, double minY, double maxX, double maxY);
+    static Region polygon(std::vector<Vertex> outline);
+    // 解析命令行参数："minX,minY,maxX,maxY" 或 "x1,y1 x2,y2 x3,y3 ..."，格式错误时返回 false
+    static bool parseBox(const std::string &text, Region &out);
+    static bool parsePolygon(const std::string &text, Region &out);
+
+    bool active() const { return !_outline.empty(); }
+    const Bounds &bounds() const { return _bounds; }
+    // 区域边界，逆时针
+    const std::vector<Vertex> &outline() const { return _outline; }
+
+    // 只比较包围盒（矩形区域时是精确的），读取阶段据此在复制顶点之前丢弃图元
+    bool mayIntersect(const Bounds &b) const { return !active() || _bounds.overlaps(b); }
+    // 环（连同其内部）与区域是否相交
+    bool intersectsRing(const std::vector<Vertex> &ring) const;
+    // 环是否整个落在区域内，此时无需裁剪
+    bool containsRing(const std::vector<Vertex> &ring) const;
+
+private:
+    bool containsPoint(double x, double y) const;
+
+    std::vector<Vertex> _outline;
+    Bounds _bounds;
+    bool _isBox = false;
+};
@@ -0,0 +1,30 @@
+﻿#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include "output_sink.h"
+
+// 三角化超出预算而退化的 group
+struct DegradedGroup
+{
+    size_t group;
+    std::string strategy; // 实际采用的回退策略
+    std::string reason;
+};
+
+// 一次转换的运行报告，结束时打印
+struct RunReport
+{
+    size_t polygons = 0;
+    size_t unionClusters = 0; // 外轮廓合并：参与布尔运算的簇数与合并后的环数
+    size_t unionRings = 0;
+    size_t groups = 0;
+    size_t triangles = 0;
+    size_t culledWallTriangles = 0; // 共用墙剔除省掉的侧面三角形
+    std::vector<DegradedGroup> degraded;
+    OutputStats output;
+    std::string writer = "inline"; // OBJ 写出方式
+    size_t writerStalls = 0;       // 几何循环因写出队列背压而等待的次数
+
+    void print(std::ostream &os) const;
+};
@@ -0,0 +1,26 @@
+﻿#pragma once
+#include <string>
+#include "region.h"
+
+// 空间分片：把图纸范围 extent 切成 cols × rows 个格子（尽量接近正方形），第 index 个格子由一个 worker 转换。
+// 每个 group 归外环包围盒中心所在的格子所有，跨越格子边界的 group 只在一个分片里输出
+struct ShardSpec
+{
+    unsigned count = 0; // 0 表示不分片
+    unsigned index = 0;
+    Bounds extent;
+
+    bool active() const { return count > 0; }
+};
+
+// 格子的列数与行数，cols * rows == count
+void shardGrid(const ShardSpec &spec, unsigned &cols, unsigned &rows);
+// 点 (x, y) 所在的格子。格子为左闭右开，落在 extent 之外的点归最近的边缘格子
+unsigned shardOwner(const ShardSpec &spec, double x, double y);
+// 第 index 个格子的范围（闭区间）。边缘格子向外延伸到无穷远，与 shardOwner 一致，
+// 因此 extent 不准确（例如 $EXTMIN/$EXTMAX 过时）也不会漏掉图元
+Bounds shardCell(const ShardSpec &spec, unsigned index);
+
+// "i/N@minX,minY,maxX,maxY"，坐标按 17 位有效数字写出，解析后与协调进程算出的格子逐位相同
+std::string formatShardSpec(const ShardSpec &spec);
+bool parseShardSpec(const std::string &text, ShardSpec &out);
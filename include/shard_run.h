@@ -0,0 +1,43 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include "cadproc.h"
+
+// 分片转换（命令行程序使用）：协调进程按图纸范围把平面切成格子，为每个格子启动一个 worker 进程
+// （本机或经由共享文件系统的其他主机），各 worker 把 OBJ 与清单写进自己的目录，最后由协调进程合并
+
+// 清单中的一个 group
+struct ShardManifestEntry
+{
+    unsigned shard = 0;
+    size_t index = 0; // 文件编号，与 file 中的 NNN 相同
+    std::string file;
+    size_t triangles = 0;
+    Bounds bounds; // 网格的 x/y 包围盒
+    std::string layer;
+};
+
+// worker 目录下的 manifest.tsv，以及协调进程合并后的清单（没有 spec 行）
+struct ShardManifest
+{
+    std::string spec; // 产生该清单的 formatShardSpec，合并时据此确认不是上一次运行留下的
+    std::vector<ShardManifestEntry> entries;
+};
+
+bool writeShardManifest(const std::string &path, const ShardManifest &manifest);
+bool readShardManifest(const std::string &path, ShardManifest &manifest);
+
+struct ShardRunOptions
+{
+    unsigned shards = 0;
+    // 启动命令模板：{cmd} 替换为整条 worker 命令（已加引号，作为一个参数），{i} 替换为分片号，
+    // 例如 "ssh node{i} {cmd}"。为空时在本机直接运行
+    std::string launch;
+    std::string workDir = "shards"; // 分片目录 <workDir>/shard_<i>，远程 worker 必须能以同一路径访问
+    bool keepShardDirs = false;     // 合并后保留分片目录（worker 日志、清单）
+};
+
+// 协调进程：读取图纸范围、并发启动 worker 并等待全部结束，再把各分片的 OBJ 移到当前目录、
+// 统一编号并写出合并后的 manifest.tsv。workerArgs 为原样转发给 worker 的转换参数
+int runShardCoordinator(const std::string &exe, const std::string &filename, const std::vector<std::string> &workerArgs,
+                        const ConvertOptions &options, const ShardRunOptions &run);
@@ -0,0 +1,45 @@
+﻿#pragma once
+#include <vector>
+#include "utils.h"
+
+// 相邻外轮廓的共用墙面：两个拉伸高度相同的实体在同一条线段两侧相接时，这段墙夹在实体中间、永远不可见。
+// 把每条边定向为“实体在左侧”（外环取内部、洞取外部），若另一条边与它端点在容差内重合且方向相反，
+// 两条边的侧面都可以省掉。只处理端点重合的整段共边，T 形相接的部分重叠不会被识别
+class SharedWalls
+{
+public:
+    // heights[g] 为 grouping.groups[g] 的拉伸高度，只有高度相同的组之间才互相剔除
+    void build(const std::vector<RawPoly> &polys, const PolyGrouping &grouping, const std::vector<float> &heights,
+               double tolerance);
+
+    // polys[poly] 的第 edge 条边（pts[edge] -> pts[edge + 1]）是否为内部墙
+    bool culled(size_t poly, size_t edge) const { return !flags.empty() && flags[offset[poly] + edge]; }
+    // 指向 polys[poly] 各边标志的指针，未构建时为空，可直接传给 generateSideTriangles
+    const char *flagsFor(size_t poly) const { return flags.empty() ? nullptr : flags.data() + offset[poly]; }
+    size_t culledEdges() const { return culledCount; }
+
+    // 与某条边重合、方向相反的一条边；a、b 是它按多边形存储方向（pts[edge] -> pts[edge + 1]）的端点，
+    // 构建时复制出来，多边形顶点被 releaseGroup 释放后仍可用
+    struct Partner
+    {
+        size_t poly, edge;
+        Vertex a, b;
+    };
+    // polys[poly] 第 edge 条边的相对边，未被剔除的边没有
+    std::vector<Partner> partners(size_t poly, size_t edge) const;
+    // 取消一条边的剔除：相对的 group 退化或被裁剪后改用新环生成侧面，这段墙不再被挡住
+    void restore(size_t poly, size_t edge);
+
+private:
+    // 一对相对的边：flag 处的边与 partner 描述的边，按 flag 排序
+    struct Link
+    {
+        size_t flag;
+        Partner partner;
+    };
+
+    std::vector<size_t> offset; // 每个多边形第一条边在 flags 中的位置
+    std::vector<char> flags;
+    std::vector<Link> links;
+    size_t culledCount = 0;
+};
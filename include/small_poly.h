@@ -0,0 +1,20 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "utils.h"
+
+// 无洞小多边形的定长三角化。建筑外轮廓大多是 4~16 个顶点的单环，
+// 走 earcut 的链表、对象池与 uint32_t 下标并不划算
+static const size_t kSmallPolyMaxVertices = 16;
+
+// 栈上的三角形下标，三个一组，与 earcut 的输出一样为逆时针
+struct SmallTriangles
+{
+    uint16_t idx[3 * (kSmallPolyMaxVertices - 2)];
+    size_t count = 0; // 下标个数
+};
+
+// 按顶点数分派到对应的模板内核：三角形、四边形与凸多边形走固定路径，其余做剪耳。
+// 顶点数超出 [3, kSmallPolyMaxVertices]、面积为 0 或剪耳卡住（自交等）时返回 false，调用方回退到 earcut
+bool triangulateSmallRing(const std::vector<Vertex> &ring, SmallTriangles &out);
@@ -0,0 +1,12 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+#include "utils.h"
+
+// 点 (x, y) 在 2^16 × 2^16 网格上的 Hilbert 曲线序号。曲线上相邻的序号在平面上也相邻，
+// 按序号排序后空间上相近的对象排在一起
+uint32_t hilbertIndex(uint32_t x, uint32_t y);
+
+// 按外环包围盒中心的 Hilbert 序号重排 grouping.groups（序号相同时保持原顺序）。
+// 只移动 PolyGroup 本身，holes 与 polys 不变
+void sortGroupsByHilbert(const std::vector<RawPoly> &polys, PolyGrouping &grouping);
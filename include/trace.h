@@ -0,0 +1,63 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+
+// Chrome trace-event 格式的时间线，写出的 JSON 可直接拖进 Perfetto 或 chrome://tracing 查看。
+// 默认关闭；开启必须在启动任何工作线程之前。事件先记在各线程自己的缓冲区里，互不加锁，
+// 所有线程结束后由 Trace::write 一次性写出
+class Trace
+{
+public:
+    static void enable();
+    static bool enabled() { return on; }
+    // 给当前线程命名，时间线上按名称显示；关闭时什么都不做
+    static void setThreadName(const char *name);
+    // 写出全部已记录的事件，返回事件数；打开文件失败返回 -1
+    static long write(const std::string &path);
+
+private:
+    inline static bool on = false;
+};
+
+// 作用域事件：构造时记开始时间，析构时记结束时间。
+// 关闭时构造只有一次对全局开关的判断，不取时间也不分配内存，arg 直接返回。
+// name 与参数名必须是字符串字面量，写出时才读取
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+    {
+        if (Trace::enabled())
+            begin(name);
+    }
+    ~TraceScope()
+    {
+        if (name)
+            end();
+    }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+    // 附加整数参数（group 下标、顶点数、三角形数等），最多 kMaxArgs 个
+    TraceScope &arg(const char *key, int64_t value)
+    {
+        if (name && argCount < kMaxArgs)
+        {
+            keys[argCount] = key;
+            values[argCount++] = value;
+        }
+        return *this;
+    }
+
+    static const int kMaxArgs = 4;
+
+private:
+    void begin(const char *eventName);
+    void end();
+
+    const char *name = nullptr;
+    uint64_t startNs = 0;
+    int argCount = 0;
+    const char *keys[kMaxArgs];
+    int64_t values[kMaxArgs];
+};
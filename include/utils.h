@@ -1,12 +1,15 @@
 #pragma once
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <string>
 #include "earcut.hpp"
+#include "output_sink.h"
 
 struct Vertex
 {
@@ -17,10 +20,109 @@ struct Vertex
     }
 };
 
+// 让 earcut 直接读取 Vertex，无需先复制成 pair 数组
+namespace mapbox
+{
+    namespace util
+    {
+        template <>
+        struct nth<0, Vertex>
+        {
+            inline static float get(const Vertex &v) { return v.x; }
+        };
+        template <>
+        struct nth<1, Vertex>
+        {
+            inline static float get(const Vertex &v) { return v.y; }
+        };
+    } // namespace util
+} // namespace mapbox
+
+// 环的外环/洞身份从哪里来
+enum class RingRole : uint8_t
+{
+    Free,       // 普通多边形，由包含关系推断外环/洞
+    HatchOuter, // HATCH 边界的外环，紧随其后的 HatchHole 都是它的洞
+    HatchHole
+};
+
+// 环的解析形状：包含关系与三角化据此走闭式的快速路径
+enum class PolyShape : uint8_t
+{
+    General,
+    Convex, // 凸多边形（允许共线点）
+    Circle  // makeCirclePoly 生成的正多边形，同时也是凸的
+};
+
 struct RawPoly
 {
     std::vector<Vertex> pts; // 2D in x,y (z usually 0)
     double area;             // signed area (abs for magnitude)
+    std::string layer;       // 所在图层，按图层合并外轮廓时使用
+    RingRole role = RingRole::Free;
+    PolyShape shape = PolyShape::General;
+    float cx = 0, cy = 0, radius = 0; // shape == Circle 时的圆心与半径
+};
+
+// 一组环（外环在前，其后为洞）的只读视图：只保存指向调用方顶点数组的指针，不复制顶点。
+// 被指向的数组必须比视图活得久
+class RingList
+{
+public:
+    RingList() = default;
+    RingList(const std::vector<std::vector<Vertex>> &rings)
+    {
+        ptrs.reserve(rings.size());
+        for (auto &r : rings)
+            ptrs.push_back(&r);
+    }
+
+    void push_back(const std::vector<Vertex> &ring) { ptrs.push_back(&ring); }
+    void clear() { ptrs.clear(); }
+    size_t size() const { return ptrs.size(); }
+    bool empty() const { return ptrs.empty(); }
+    const std::vector<Vertex> &operator[](size_t i) const { return *ptrs[i]; }
+
+    struct const_iterator
+    {
+        const std::vector<Vertex> *const *p;
+        const std::vector<Vertex> &operator*() const { return **p; }
+        const_iterator &operator++()
+        {
+            ++p;
+            return *this;
+        }
+        bool operator!=(const const_iterator &o) const { return p != o.p; }
+    };
+    const_iterator begin() const { return {ptrs.data()}; }
+    const_iterator end() const { return {ptrs.data() + ptrs.size()}; }
+
+private:
+    std::vector<const std::vector<Vertex> *> ptrs;
+};
+
+// 外环与洞的分组结果只记录下标，顶点仍留在读取器的 polys 中
+struct PolyGroup
+{
+    size_t outer;     // 外环在 polys 中的下标
+    size_t holeBegin; // 本组洞下标在 PolyGrouping::holes 中的起点
+    size_t holeCount;
+};
+
+struct PolyGrouping
+{
+    std::vector<PolyGroup> groups;
+    std::vector<size_t> holes; // 各组的洞下标依次排列
+
+    // 外环在前、洞在后的环视图，指向 polys 中的顶点
+    RingList rings(const std::vector<RawPoly> &polys, const PolyGroup &g) const
+    {
+        RingList r;
+        r.push_back(polys[g.outer].pts);
+        for (size_t k = 0; k < g.holeCount; k++)
+            r.push_back(polys[holes[g.holeBegin + k]].pts);
+        return r;
+    }
 };
 
 struct Face
@@ -28,9 +130,88 @@ struct Face
     int a, b, c;
 };
 
+// 按文件头签名区分输入格式
+enum class CadFileKind
+{
+    Unknown,
+    AsciiDxf,
+    BinaryDxf,
+    Dwg
+};
+CadFileKind detectCadFileKind(const std::string &filename);
+// 同上，按内存中文件内容的开头判断
+CadFileKind detectCadBufferKind(const char *head, size_t n);
+
+// 点在多边形内或边界上时返回 true
 bool pointInPoly(const std::vector<Vertex> &poly, double x, double y);
 double polygonSignedArea(const std::vector<Vertex> &pts);
-std::vector<Vertex> triangulateRingsToTris(const std::vector<std::vector<Vertex>> &polygonRings, float zTop, float zBottom);
-std::vector<Vertex> generateSideTriangles(const std::vector<Vertex> &ring, float height);
+RawPoly makeCirclePoly(double cx, double cy, double radius, int segments = 64);
+// 面积不为 0 的简单凸环：各顶点转向一致（共线点只能沿原方向继续），y 方向至多变号两次
+bool isConvexRing(const std::vector<Vertex> &pts);
+void finalizeRawPoly(RawPoly &p);
+// 单个 group 的三角化预算，0 表示不限
+struct TriangulationBudget
+{
+    size_t maxIterations = 0;
+    double maxMillis = 0;
+};
+
+// 顶/底面三角化引擎
+enum class TriEngine
+{
+    Auto,     // 按顶点数与洞数自动选择
+    Earcut,   // mapbox::earcut，小多边形最快
+    Monotone, // 扫描线单调剖分，O(n log n)，适合超大多边形和大量洞
+    Small,    // 无洞小多边形（≤ 16 个顶点）的定长内核，只由 Auto 选用
+    Fan       // 已知为凸的无洞环直接扇形展开，只由 Auto 选用
+};
+
+struct TriangulationOptions
+{
+    TriangulationBudget budget; // 仅约束 earcut
+    TriEngine engine = TriEngine::Auto;
+    // Auto 模式下顶点数或洞数达到阈值时改用单调剖分
+    size_t monotoneMinVertices = 20000;
+    size_t monotoneMinHoles = 32;
+    // earcut 总顶点数超过该值时用 z-order 哈希查找耳尖内的点
+    size_t earcutHashThreshold = 80;
+};
+
+struct TriangulationStatus
+{
+    bool completed = true;
+    bool timedOut = false;
+    size_t iterations = 0;
+    TriEngine engine = TriEngine::Earcut; // 实际使用的引擎
+};
+
+// 超出预算后实际采用的顶/底面策略
+enum class CapFallback
+{
+    None,       // earcut 正常完成
+    Simplified, // 抽稀后的外环与洞重新 earcut
+    ConvexHull, // 外环凸包直接扇形三角化
+    Skipped     // 无法生成顶/底面
+};
+const char *capFallbackName(CapFallback f);
+
+// convex 为真表示调用方已知唯一的环是凸的（RawPoly::shape），Auto 模式下直接扇形展开
+std::vector<Vertex> triangulateRingsToTris(const RingList &polygonRings, float zTop, float zBottom,
+                                           const TriangulationOptions &options = {}, TriangulationStatus *status = nullptr,
+                                           bool convex = false);
+// 带预算的三角化：超出预算时依次退化为抽稀环、凸包，退化后的环存放在 fallbackRings 中，
+// rings 随之改为指向它们（侧面应据此生成），reason 记录退化原因
+CapFallback triangulateWithFallback(RingList &rings, float zTop, float zBottom, const TriangulationOptions &options,
+                                    std::vector<Vertex> &tris, std::string &reason,
+                                    std::vector<std::vector<Vertex>> &fallbackRings, bool convex = false);
+std::vector<Vertex> simplifyRing(const std::vector<Vertex> &ring, double tolerance);
+std::vector<Vertex> convexHull(const std::vector<Vertex> &pts);
+// culled 非空时，culled[i] 为真的边（ring[i] -> ring[i + 1]）不生成墙面
+std::vector<Vertex> generateSideTriangles(const std::vector<Vertex> &ring, float height, const char *culled = nullptr);
 void appendVerts(std::vector<Vertex> &dst, const std::vector<Vertex> &src);
-void exportGroupToOBJ(const std::vector<Vertex> &verts, size_t index);
\ No newline at end of file
+// group 的输出文件名：shape_<index>.obj，压缩时追加 .gz/.zst
+std::string groupObjFileName(size_t index, OutputCompression compression);
+// 写出 shape_<index>.obj，按 options 边写边压缩（文件名追加 .gz/.zst），字节数累加到 stats。
+// 成功时不打印，由调用方决定是否输出 "Exported ..."（写出线程上不打印，避免与主线程日志交错）
+bool exportGroupToOBJ(const std::vector<Vertex> &verts, size_t index, const OutputOptions &options = {},
+                      OutputStats *stats = nullptr);
\ No newline at end of file
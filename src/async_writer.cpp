@@ -0,0 +1,89 @@
+﻿#include "async_writer.h"
+#include "trace.h"
+
+AsyncObjWriter::AsyncObjWriter(const OutputOptions &output_, OutputStats *stats_, const AsyncWriterOptions &options)
+    : queue(options.queueSlots), output(output_), stats(stats_), maxBytesInFlight(options.maxBytesInFlight)
+{
+    if (options.useIoUring)
+        ring = IoRing::create();
+    output.ring = ring.get();
+    worker = std::thread(&AsyncObjWriter::run, this);
+}
+
+AsyncObjWriter::~AsyncObjWriter()
+{
+    finish();
+}
+
+void AsyncObjWriter::submit(size_t index, std::vector<Vertex> &&verts)
+{
+    const size_t bytes = verts.size() * sizeof(Vertex);
+    bool stalled = false;
+    // 在途内存超限时等写出线程消化；没有在途网格时总是放行，单个超大网格也能提交
+    auto overBudget = [&]
+    {
+        const size_t inFlight = bytesInFlight.load(std::memory_order_acquire);
+        return inFlight > 0 && inFlight + bytes > maxBytesInFlight;
+    };
+    if (overBudget())
+    {
+        stalled = true;
+        std::unique_lock<std::mutex> lock(mutex);
+        jobDone.wait(lock, [&]
+                     { return !overBudget(); });
+    }
+    bytesInFlight.fetch_add(bytes, std::memory_order_acq_rel);
+
+    Job job{index, std::move(verts)};
+    if (!queue.tryPush(job))
+    {
+        stalled = true;
+        std::unique_lock<std::mutex> lock(mutex);
+        jobDone.wait(lock, [&]
+                     { return queue.tryPush(job); });
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    jobReady.notify_one();
+    if (stalled)
+        stallCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AsyncObjWriter::finish()
+{
+    if (!worker.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    jobReady.notify_one();
+    worker.join();
+}
+
+void AsyncObjWriter::run()
+{
+    Trace::setThreadName("obj writer");
+    for (;;)
+    {
+        std::optional<Job> job = queue.tryPop();
+        if (!job)
+        {
+            // finish 之前提交的网格都已入队，看到 done 后再取一次，仍为空才退出
+            std::unique_lock<std::mutex> lock(mutex);
+            jobReady.wait(lock, [&]
+                          { return (job = queue.tryPop()) || done; });
+            if (!job)
+                break;
+        }
+        const size_t bytes = job->verts.size() * sizeof(Vertex);
+        exportGroupToOBJ(job->verts, job->index, output, stats);
+        job.reset();
+        bytesInFlight.fetch_sub(bytes, std::memory_order_acq_rel);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        jobDone.notify_one();
+    }
+}
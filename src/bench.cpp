@@ -0,0 +1,440 @@
+﻿#include "bench.h"
+#include "MyDxf_reader.hpp"
+#include "containment.h"
+#include "fast_dxf_reader.h"
+#include "monotone.h"
+#include "predicates.h"
+#include "utils.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+static double ms(Clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+// 对比直接读取 DWG 与“外部转换为 DXF 再读取”的耗时。
+// convertCmd 为外部转换命令模板，其中 {in}/{out} 会被替换为输入 DWG 与临时 DXF 路径，
+// 例如 LibreDWG 的 "dwg2dxf -y -o {out} {in}"
+int benchDwg(const std::string &filename, std::string convertCmd)
+{
+    MyDXFReader direct(100.0, "");
+    direct.verbose = false;
+    auto t0 = Clock::now();
+    bool okDirect = readWithDwgR(filename, direct);
+    auto t1 = Clock::now();
+    std::cout << "dwgR::read        : " << (okDirect ? "ok" : "failed") << ", " << direct.polys.size()
+              << " polygons, " << ms(t1 - t0) << " ms\n";
+
+    const std::string tmpDxf = filename + ".bench.dxf";
+    for (auto [key, value] : {std::make_pair(std::string("{in}"), filename), std::make_pair(std::string("{out}"), tmpDxf)})
+    {
+        for (size_t pos; (pos = convertCmd.find(key)) != std::string::npos;)
+            convertCmd.replace(pos, key.size(), value);
+    }
+    auto t2 = Clock::now();
+    int rc = std::system(convertCmd.c_str());
+    auto t3 = Clock::now();
+    MyDXFReader converted(100.0, "");
+    converted.verbose = false;
+    bool okConverted = rc == 0 && readWithLibdxfrw(tmpDxf, converted);
+    auto t4 = Clock::now();
+    std::remove(tmpDxf.c_str());
+
+    std::cout << "convert + dxfRW   : " << (okConverted ? "ok" : "failed") << ", " << converted.polys.size()
+              << " polygons, " << ms(t4 - t2) << " ms (convert " << ms(t3 - t2)
+              << " ms, read " << ms(t4 - t3) << " ms)\n";
+    return okDirect ? 0 : 1;
+}
+
+// 分别计时 dxfRW::read 与内存映射快速路径，用于对比（建议用放大后的 sample.dxf）
+int benchParse(const std::string &filename, unsigned threads)
+{
+    MyDXFReader ref(100.0, "");
+    ref.verbose = false;
+    auto t0 = Clock::now();
+    bool okRef = readWithLibdxfrw(filename, ref);
+    auto t1 = Clock::now();
+
+    std::vector<RawPoly> fast;
+    bool okFast = readDxfFast(filename, fast);
+    auto t2 = Clock::now();
+
+    std::vector<RawPoly> parallel;
+    bool okParallel = readDxfFast(filename, parallel, threads);
+    auto t3 = Clock::now();
+
+    std::cout << "dxfRW::read : " << (okRef ? "ok" : "failed") << ", " << ref.polys.size()
+              << " polygons, " << ms(t1 - t0) << " ms\n";
+    std::cout << "readDxfFast : " << (okFast ? "ok" : "fallback") << ", " << fast.size()
+              << " polygons, " << ms(t2 - t1) << " ms\n";
+    std::cout << "readDxfFast x" << threads << ": " << (okParallel ? "ok" : "fallback") << ", " << parallel.size()
+              << " polygons, " << ms(t3 - t2) << " ms\n";
+    return okRef ? 0 : 1;
+}
+
+// 生成等高线式的星形外环（半径带高频噪声，反凹点很多）和网格排布的六边形洞
+static std::vector<std::vector<Vertex>> makeContourPolygon(size_t vertices, size_t holes, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> noise(0.0, 1.0);
+    std::vector<std::vector<Vertex>> rings(1);
+    const double R = 1000.0;
+    for (size_t i = 0; i < vertices; i++)
+    {
+        double t = 2.0 * M_PI * i / vertices;
+        double r = R * (1.0 + 0.3 * std::sin(7 * t) + 0.1 * std::sin(53 * t) + 0.2 * noise(rng));
+        rings[0].push_back({(float)(r * std::cos(t)), (float)(r * std::sin(t)), 0.0f});
+    }
+    // 洞都放在半径 0.6R 的内切区域里，互不相交
+    size_t grid = (size_t)std::ceil(std::sqrt((double)holes));
+    double cell = 800.0 / std::max<size_t>(grid, 1);
+    for (size_t k = 0; k < holes; k++)
+    {
+        double cx = -400.0 + cell * (k % grid + 0.5);
+        double cy = -400.0 + cell * (k / grid + 0.5);
+        std::vector<Vertex> hole;
+        for (int q = 0; q < 6; q++)
+        {
+            double t = 2.0 * M_PI * q / 6;
+            hole.push_back({(float)(cx + cell * 0.3 * std::cos(t)), (float)(cy + cell * 0.3 * std::sin(t)), 0.0f});
+        }
+        rings.push_back(std::move(hole));
+    }
+    return rings;
+}
+
+int benchTriangulation()
+{
+    TriangulationOptions earcutOnly, monotoneOnly;
+    earcutOnly.engine = TriEngine::Earcut;
+    monotoneOnly.engine = TriEngine::Monotone;
+
+    std::cout << std::setw(10) << "vertices" << std::setw(8) << "holes"
+              << std::setw(14) << "earcut ms" << std::setw(14) << "monotone ms" << std::setw(12) << "triangles\n";
+    for (size_t vertices : {1000, 10000, 100000, 300000})
+    {
+        for (size_t holes : {0, 100, 1000})
+        {
+            auto rings = makeContourPolygon(vertices, holes, (unsigned)(vertices + holes));
+            TriangulationStatus st;
+
+            auto t0 = Clock::now();
+            auto a = triangulateRingsToTris(rings, 1.0f, 0.0f, earcutOnly, &st);
+            auto t1 = Clock::now();
+            auto b = triangulateRingsToTris(rings, 1.0f, 0.0f, monotoneOnly, &st);
+            auto t2 = Clock::now();
+
+            std::cout << std::setw(10) << vertices << std::setw(8) << holes
+                      << std::setw(14) << ms(t1 - t0) << std::setw(14) << ms(t2 - t1)
+                      << std::setw(11) << a.size() / 6
+                      << (st.engine == TriEngine::Monotone ? "" : "  (monotone fell back to earcut)") << std::endl;
+            if (a.size() != b.size())
+                std::cout << "  triangle count mismatch: earcut " << a.size() / 6 << ", monotone " << b.size() / 6 << "\n";
+        }
+    }
+    return 0;
+}
+
+// 外环为 1000 边的圆，洞为网格排布的小正方形
+static std::vector<std::vector<std::pair<double, double>>> makePerforatedPolygon(size_t holes)
+{
+    std::vector<std::vector<std::pair<double, double>>> rings(1);
+    const double R = 1000.0;
+    for (int i = 0; i < 1000; i++)
+    {
+        double t = 2.0 * M_PI * i / 1000;
+        rings[0].push_back({R * std::cos(t), R * std::sin(t)});
+    }
+    size_t grid = (size_t)std::ceil(std::sqrt((double)holes));
+    double cell = 1200.0 / grid, s = cell * 0.25;
+    for (size_t k = 0; k < holes; k++)
+    {
+        double cx = -600.0 + cell * (k % grid + 0.5);
+        double cy = -600.0 + cell * (k / grid + 0.5);
+        rings.push_back({{cx - s, cy - s}, {cx - s, cy + s}, {cx + s, cy + s}, {cx + s, cy - s}});
+    }
+    return rings;
+}
+
+int benchHoleBridging()
+{
+    std::cout << std::setw(8) << "holes" << std::setw(14) << "linear ms" << std::setw(14) << "indexed ms"
+              << std::setw(12) << "triangles" << "\n";
+    for (size_t holes : {1, 10, 100, 1000, 10000})
+    {
+        auto rings = makePerforatedPolygon(holes);
+        mapbox::detail::Earcut<uint32_t> linear, indexed;
+        linear.holeIndexThreshold = std::numeric_limits<std::size_t>::max();
+        indexed.holeIndexThreshold = 1;
+
+        auto t0 = Clock::now();
+        linear(rings);
+        auto t1 = Clock::now();
+        indexed(rings);
+        auto t2 = Clock::now();
+
+        std::cout << std::setw(8) << holes << std::setw(14) << ms(t1 - t0) << std::setw(14) << ms(t2 - t1)
+                  << std::setw(12) << indexed.indices.size() / 3;
+        if (linear.indices.size() != indexed.indices.size())
+            std::cout << "  (linear produced " << linear.indices.size() / 3 << ")";
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+int benchEarTest()
+{
+    std::cout << std::setw(10) << "vertices" << std::setw(8) << "reps" << std::setw(14) << "no-hash ms"
+              << std::setw(14) << "scalar ms" << std::setw(14) << "simd ms" << std::setw(12) << "identical" << "\n";
+    for (size_t vertices : {40, 80, 160, 320, 1000, 3000, 10000, 30000, 100000})
+    {
+        auto contour = makeContourPolygon(vertices, 0, (unsigned)vertices);
+        std::vector<std::vector<std::pair<double, double>>> rings(1);
+        for (const auto &v : contour[0])
+            rings[0].push_back({v.x, v.y});
+        // 小多边形重复多次，使每一行的总工作量相近
+        const size_t reps = std::max<size_t>(1, 400000 / vertices);
+
+        mapbox::detail::Earcut<uint32_t> noHash, scalar, simd;
+        noHash.hashThreshold = std::numeric_limits<std::size_t>::max();
+        noHash.simdEarThreshold = std::numeric_limits<std::size_t>::max();
+        scalar.hashThreshold = 0;
+        scalar.simdEarThreshold = std::numeric_limits<std::size_t>::max();
+        simd.hashThreshold = 0;
+        simd.simdEarThreshold = 0;
+
+        // 不哈希的逐点遍历是 O(n^2)，只在小规模下对照，用于确定哈希阈值
+        const bool runNoHash = vertices <= 1000;
+        auto t0 = Clock::now();
+        for (size_t r = 0; runNoHash && r < reps; r++)
+            noHash(rings);
+        auto t1 = Clock::now();
+        for (size_t r = 0; r < reps; r++)
+            scalar(rings);
+        auto t2 = Clock::now();
+        for (size_t r = 0; r < reps; r++)
+            simd(rings);
+        auto t3 = Clock::now();
+
+        std::cout << std::setw(10) << vertices << std::setw(8) << reps;
+        if (runNoHash)
+            std::cout << std::setw(14) << ms(t1 - t0);
+        else
+            std::cout << std::setw(14) << "-";
+        std::cout << std::setw(14) << ms(t2 - t1) << std::setw(14) << ms(t3 - t2)
+                  << std::setw(12) << (scalar.indices == simd.indices ? "yes" : "NO") << std::endl;
+    }
+    return 0;
+}
+
+// 建筑外轮廓式的小多边形：凸多边形（圆上取点）或星形凹多边形（半径交替），角度带抖动
+static std::vector<std::vector<Vertex>> makeSmallRings(size_t vertices, bool convex, size_t count, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> jitter(0.0, 0.8);
+    std::vector<std::vector<Vertex>> rings(count);
+    for (size_t k = 0; k < count; k++)
+    {
+        const double cx = (double)(k % 1000) * 50.0, cy = (double)(k / 1000) * 50.0;
+        for (size_t i = 0; i < vertices; i++)
+        {
+            const double t = 2.0 * M_PI * (i + jitter(rng)) / vertices;
+            const double r = convex || i % 2 == 0 ? 20.0 : 8.0 + 8.0 * jitter(rng);
+            rings[k].push_back({(float)(cx + r * std::cos(t)), (float)(cy + r * std::sin(t)), 0.0f});
+        }
+    }
+    return rings;
+}
+
+int benchSmallPolygons()
+{
+    TriangulationOptions earcutOnly, autoEngine;
+    earcutOnly.engine = TriEngine::Earcut;
+    const size_t count = 200000;
+    const auto precision = std::cout.precision(3);
+
+    std::cout << std::setw(10) << "vertices" << std::setw(10) << "shape" << std::setw(14) << "earcut ms"
+              << std::setw(14) << "kernel ms" << std::setw(10) << "speedup" << std::setw(12) << "kernel hit\n";
+    for (size_t vertices : {4, 6, 8, 12, 16})
+    {
+        for (bool convex : {true, false})
+        {
+            if (!convex && vertices < 6)
+                continue;
+            auto rings = makeSmallRings(vertices, convex, count, (unsigned)vertices);
+            size_t earcutTris = 0, kernelTris = 0, hits = 0;
+            TriangulationStatus st;
+
+            auto t0 = Clock::now();
+            for (const auto &ring : rings)
+            {
+                RingList single;
+                single.push_back(ring);
+                earcutTris += triangulateRingsToTris(single, 1.0f, 0.0f, earcutOnly).size() / 6;
+            }
+            auto t1 = Clock::now();
+            for (const auto &ring : rings)
+            {
+                RingList single;
+                single.push_back(ring);
+                kernelTris += triangulateRingsToTris(single, 1.0f, 0.0f, autoEngine, &st).size() / 6;
+                hits += st.engine == TriEngine::Small;
+            }
+            auto t2 = Clock::now();
+
+            std::cout << std::setw(10) << vertices << std::setw(10) << (convex ? "convex" : "concave")
+                      << std::setw(14) << ms(t1 - t0) << std::setw(14) << ms(t2 - t1)
+                      << std::setw(9) << ms(t1 - t0) / ms(t2 - t1) << "x"
+                      << std::setw(10) << 100.0 * hits / count << "%" << std::endl;
+            if (earcutTris != kernelTris)
+                std::cout << "  triangle count mismatch: earcut " << earcutTris << ", kernel " << kernelTris << "\n";
+        }
+    }
+    std::cout.precision(precision);
+    return 0;
+}
+
+// 随机点与近共线点（在线段上取点后舍入到 float）两组输入：普通浮点、带过滤的自适应、纯精确三种
+// orient2d 的耗时，过滤失败（退回精确计算）的比例，以及普通浮点给出错误符号的次数。
+// 输入放得进缓存并重复多轮，测的是谓词本身而不是内存带宽
+int benchPredicates()
+{
+    const size_t count = 1 << 14, reps = 200;
+    const auto precision = std::cout.precision(3);
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> coord(-1000.0, 1000.0), unit(0.0, 1.0);
+
+    std::cout << std::setw(16) << "input" << std::setw(12) << "plain ns" << std::setw(12) << "filter ns"
+              << std::setw(12) << "exact ns" << std::setw(12) << "fallback" << std::setw(14) << "plain wrong\n";
+    for (bool degenerate : {false, true})
+    {
+        std::vector<double> pts(count * 6);
+        for (size_t i = 0; i < count; i++)
+        {
+            double *p = &pts[i * 6];
+            for (int k = 0; k < 6; k++)
+                p[k] = (float)coord(rng);
+            if (degenerate)
+            {
+                // c 取在 ab 上再舍入，真实符号由舍入方向决定
+                const double t = unit(rng);
+                p[4] = (float)(p[0] + t * (p[2] - p[0]));
+                p[5] = (float)(p[1] + t * (p[3] - p[1]));
+            }
+        }
+
+        // 三种实现各跑 reps 轮，累加符号防止被优化掉，顺便核对过滤版与精确版一致
+        auto run = [&](auto orient)
+        {
+            long sum = 0;
+            auto t0 = Clock::now();
+            for (size_t r = 0; r < reps; r++)
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    const double *p = &pts[i * 6];
+                    const double v = orient(p[0], p[1], p[2], p[3], p[4], p[5]);
+                    sum += (v > 0) - (v < 0);
+                }
+            }
+            return std::make_pair(ms(Clock::now() - t0) * 1e6 / double(count * reps), sum);
+        };
+        const auto plain = run([](double ax, double ay, double bx, double by, double cx, double cy)
+                               { return orient2dFast(ax, ay, bx, by, cx, cy); });
+        const auto filtered = run([](double ax, double ay, double bx, double by, double cx, double cy)
+                                  { return orient2d(ax, ay, bx, by, cx, cy); });
+        const auto exact = run([](double ax, double ay, double bx, double by, double cx, double cy)
+                               { return orient2dExact(ax, ay, bx, by, cx, cy); });
+
+        size_t fallback = 0, wrong = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const double *p = &pts[i * 6];
+            double det;
+            fallback += !orient2dFiltered(p[0], p[1], p[2], p[3], p[4], p[5], det);
+            const double e = orient2dExact(p[0], p[1], p[2], p[3], p[4], p[5]);
+            wrong += (det > 0) - (det < 0) != (e > 0) - (e < 0);
+        }
+
+        std::cout << std::setw(16) << (degenerate ? "near-collinear" : "random") << std::setw(12) << plain.first
+                  << std::setw(12) << filtered.first << std::setw(12) << exact.first
+                  << std::setw(11) << 100.0 * fallback / count << "%" << std::setw(13) << wrong << std::endl;
+        if (filtered.second != exact.second)
+            std::cout << "  filtered and exact signs disagree (plain sum " << plain.second << ")\n";
+    }
+    std::cout.precision(precision);
+    return 0;
+}
+
+// 城市街区式的合成数据：外围一个贯穿全图的大环（其边跨过所有分段），每个街区一栋建筑，
+// 建筑带天井（洞），天井里有岛，旁边有圆形构筑物；形状在矩形、凸多边形与凹多边形之间轮换
+static std::vector<RawPoly> makeCityBlocks(size_t blocks)
+{
+    std::vector<RawPoly> polys;
+    const size_t side = (size_t)std::ceil(std::sqrt((double)blocks));
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> jitter(-2.0, 2.0);
+    auto ring = [&](double cx, double cy, double r, size_t n, bool star)
+    {
+        RawPoly p;
+        for (size_t i = 0; i < n; i++)
+        {
+            const double t = 2.0 * M_PI * i / n;
+            const double rr = star && i % 2 ? r * 0.7 : r;
+            p.pts.push_back({(float)(cx + rr * std::cos(t)), (float)(cy + rr * std::sin(t)), 0.0f});
+        }
+        finalizeRawPoly(p);
+        return p;
+    };
+    const double extent = side * 100.0;
+    RawPoly site;
+    site.pts = {{-10.0f, -10.0f, 0.0f}, {(float)extent, -10.0f, 0.0f}, {(float)extent, (float)extent, 0.0f}, {-10.0f, (float)extent, 0.0f}};
+    finalizeRawPoly(site);
+    polys.push_back(site);
+    for (size_t b = 0; b < blocks; b++)
+    {
+        const double cx = (b % side) * 100.0 + 45.0 + jitter(rng), cy = (b / side) * 100.0 + 45.0 + jitter(rng);
+        const size_t n = b % 3 == 0 ? 4 : b % 3 == 1 ? 12 : 16;
+        polys.push_back(ring(cx, cy, 40.0, n, b % 3 == 2));
+        polys.push_back(ring(cx, cy, 20.0, n, false));
+        polys.push_back(ring(cx, cy, 8.0, 6, false));
+        polys.push_back(makeCirclePoly(cx + 30.0, cy + 30.0, 3.0, 16));
+    }
+    return polys;
+}
+
+int benchContainment()
+{
+    const size_t blocks = 125000; // 约 50 万个多边形
+    const auto polys = makeCityBlocks(blocks);
+    size_t vertices = 0;
+    for (const auto &p : polys)
+        vertices += p.pts.size();
+    std::cout << polys.size() << " polygons, " << vertices << " vertices, " << std::thread::hardware_concurrency()
+              << " hardware threads\n";
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "ms" << std::setw(10) << "speedup"
+              << std::setw(12) << "identical\n";
+    ContainmentTree reference;
+    double base = 0;
+    for (unsigned threads : {1u, 2u, 4u, 8u, 16u, 32u, 64u})
+    {
+        auto t0 = Clock::now();
+        ContainmentTree tree = buildContainmentTree(polys, threads);
+        const double elapsed = ms(Clock::now() - t0);
+        if (threads == 1)
+        {
+            reference = tree;
+            base = elapsed;
+        }
+        const bool same = tree.parent == reference.parent && tree.depth == reference.depth;
+        std::cout << std::setw(8) << threads << std::setw(14) << elapsed << std::setw(9) << base / elapsed << "x"
+                  << std::setw(11) << (same ? "yes" : "NO") << std::endl;
+    }
+    return 0;
+}
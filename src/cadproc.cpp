@@ -0,0 +1,488 @@
+﻿#include "cadproc.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include "MyDxf_reader.hpp"
+#include "fast_dxf_reader.h"
+#include "shard.h"
+#include "shared_walls.h"
+#include "spatial_order.h"
+#include "trace.h"
+
+namespace
+{
+    bool isCancelled(const ConvertCallbacks &callbacks)
+    {
+        return callbacks.cancelled && callbacks.cancelled();
+    }
+
+    void reportProgress(const ConvertCallbacks &callbacks, ConvertStage stage, size_t done, size_t total)
+    {
+        if (callbacks.onProgress)
+            callbacks.onProgress({stage, done, total});
+    }
+
+    // libdxfrw 只能读文件：内存中的内容先写到临时文件，读完即删
+    bool readBufferWithLibdxfrw(const char *data, size_t size, CadFileKind kind, MyDXFReader &reader)
+    {
+        static std::atomic<unsigned> counter{0};
+        std::error_code ec;
+        const std::filesystem::path dir = std::filesystem::temp_directory_path(ec);
+        if (ec)
+            return false;
+        const std::string name = "cadproc_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) +
+                                 "_" + std::to_string(counter++) + (kind == CadFileKind::Dwg ? ".dwg" : ".dxf");
+        const std::string path = (dir / name).string();
+        {
+            std::ofstream out(path, std::ios::binary);
+            if (!out.write(data, (std::streamsize)size))
+                return false;
+        }
+        const bool ok = kind == CadFileKind::Dwg ? readWithDwgR(path, reader) : readWithLibdxfrw(path, reader);
+        std::remove(path.c_str());
+        return ok;
+    }
+
+    // 按文件签名选择读取方式：DWG 走 dwgR，ASCII DXF 可选快速路径，其余交给 dxfRW。
+    // filename 为空时读取内存中的 data
+    bool readSource(const std::string *filename, const char *data, size_t size, const ConvertOptions &options,
+                    MyDXFReader &reader)
+    {
+        const CadFileKind kind = filename ? detectCadFileKind(*filename) : detectCadBufferKind(data, size);
+        if (kind == CadFileKind::Unknown)
+            return false;
+        if (kind == CadFileKind::Dwg)
+            return filename ? readWithDwgR(*filename, reader) : readBufferWithLibdxfrw(data, size, kind, reader);
+        // 内存中的 ASCII DXF 总是先试快速路径，能省掉临时文件
+        if (kind == CadFileKind::AsciiDxf && (options.useFastReader || !filename))
+        {
+            if (filename ? readDxfFast(*filename, reader.polys, options.threads, reader.region)
+                         : readDxfFastBuffer(data, size, reader.polys, options.threads, reader.region))
+                return true;
+            if (options.log)
+                *options.log << "Fast reader unavailable for this file, falling back to libdxfrw.\n";
+        }
+        return filename ? readWithLibdxfrw(*filename, reader) : readBufferWithLibdxfrw(data, size, kind, reader);
+    }
+
+    // 读取、（可选的）外轮廓合并与分组。readRegion 非空时读取阶段丢弃包围盒与之不相交的图元
+    ConvertStatus loadGroups(const std::string *filename, const char *data, size_t size, const ConvertOptions &options,
+                             const ConvertCallbacks &callbacks, const Region *readRegion, MyDXFReader &reader,
+                             PolyGrouping &grouping, RunReport &report)
+    {
+        std::ostream *log = options.log;
+        reader.verbose = log != nullptr;
+        reader.region = readRegion;
+
+        reportProgress(callbacks, ConvertStage::Reading, 0, 1);
+        if (!readSource(filename, data, size, options, reader))
+            return ConvertStatus::ReadFailed;
+        reportProgress(callbacks, ConvertStage::Reading, 1, 1);
+        if (log)
+            *log << "Parsed polygons: " << reader.polys.size() << "\n";
+        report.polygons = reader.polys.size();
+        if (isCancelled(callbacks))
+            return ConvertStatus::Cancelled;
+
+        if (options.unionMode != UnionMode::Off)
+        {
+            reportProgress(callbacks, ConvertStage::Union, 0, 1);
+            TraceScope trace("union");
+            UnionStats unionStats;
+            unionFootprints(reader.polys, options.unionMode, &unionStats);
+            trace.arg("clusters", (int64_t)unionStats.clusters).arg("rings", (int64_t)unionStats.outputRings);
+            if (log)
+                *log << "Footprint union: " << unionStats.inputRings << " -> " << unionStats.outputRings
+                     << " rings (" << unionStats.clusters << " overlapping clusters)\n";
+            report.unionClusters = unionStats.clusters;
+            report.unionRings = unionStats.outputRings;
+            reportProgress(callbacks, ConvertStage::Union, 1, 1);
+            if (isCancelled(callbacks))
+                return ConvertStatus::Cancelled;
+        }
+
+        reportProgress(callbacks, ConvertStage::Grouping, 0, 1);
+        TraceScope trace("group");
+        grouping = reader.groupOuterWithHoles(options.threads);
+        trace.arg("polygons", (int64_t)reader.polys.size()).arg("groups", (int64_t)grouping.groups.size());
+        return ConvertStatus::Ok;
+    }
+
+    // 外环包围盒中心所在的分片
+    unsigned groupShard(const ShardSpec &shard, const std::vector<RawPoly> &polys, const PolyGroup &g)
+    {
+        const Bounds b = boundsOfRing(polys[g.outer].pts);
+        return shardOwner(shard, (b.minX + b.maxX) * 0.5, (b.minY + b.maxY) * 0.5);
+    }
+
+    // 只扫描 ASCII DXF 的 HEADER 段，取 $EXTMIN/$EXTMAX 的 x、y。没有 HEADER 段、缺少这两项
+    // 或范围无效（空图纸的 $EXTMIN 为 1e20）时返回 false
+    bool readHeaderExtents(const std::string &filename, Bounds &extent)
+    {
+        std::ifstream in(filename, std::ios::binary);
+        std::string code, value, variable;
+        double ext[2][2] = {{NAN, NAN}, {NAN, NAN}}; // [$EXTMIN/$EXTMAX][x/y]
+        bool inHeader = false;
+        auto trim = [](std::string &s)
+        {
+            s.erase(0, s.find_first_not_of(" \t"));
+            s.erase(s.find_last_not_of(" \t\r") + 1);
+        };
+        while (std::getline(in, code) && std::getline(in, value))
+        {
+            trim(code);
+            trim(value);
+            if (code == "2" && !inHeader)
+            {
+                if (value != "HEADER")
+                    return false;
+                inHeader = true;
+            }
+            else if (code == "0" && value == "ENDSEC")
+                break;
+            else if (code == "9")
+                variable = value;
+            else if ((code == "10" || code == "20") && (variable == "$EXTMIN" || variable == "$EXTMAX"))
+                ext[variable == "$EXTMAX"][code == "20"] = std::atof(value.c_str());
+        }
+        Bounds b;
+        b.add(ext[0][0], ext[0][1]);
+        b.add(ext[1][0], ext[1][1]);
+        if (!(ext[0][0] <= ext[1][0] && ext[0][1] <= ext[1][1]) || std::fabs(b.minX) > 1e19 || std::fabs(b.maxX) > 1e19 ||
+            std::fabs(b.minY) > 1e19 || std::fabs(b.maxY) > 1e19)
+            return false;
+        extent = b;
+        return true;
+    }
+
+    // 读取并分组，再按区域、分片归属筛选 group，按需构建共用墙与 Hilbert 排序，得到要拉伸的 group 列表
+    ConvertStatus prepareGroups(const std::string *filename, const char *data, size_t size, const ConvertOptions &options,
+                                const ConvertCallbacks &callbacks, MyDXFReader &reader, PolyGrouping &grouping,
+                                SharedWalls &walls, RunReport &report)
+    {
+        std::ostream *log = options.log;
+        const Region *region = options.region.active() ? &options.region : nullptr;
+        // 读取阶段只保留包围盒与读取范围相交的图元：分片时为本格子，否则为区域（若有）的包围盒。
+        // 区域本身只用于下面按外环精确筛选 group
+        const ShardSpec &shard = options.shard;
+        Region readArea;
+        if (shard.active())
+        {
+            const Bounds cell = shardCell(shard, shard.index);
+            readArea = Region::box(cell.minX, cell.minY, cell.maxX, cell.maxY);
+        }
+        else if (region)
+            readArea = Region::box(region->bounds().minX, region->bounds().minY, region->bounds().maxX, region->bounds().maxY);
+        const Region *readRegion = readArea.active() ? &readArea : nullptr;
+
+        ConvertStatus status = loadGroups(filename, data, size, options, callbacks, readRegion, reader, grouping, report);
+        if (status != ConvertStatus::Ok)
+            return status;
+        // 要输出的 group 伸出读取范围时，它在范围外的洞、岛可能没有读到，拉伸出来会是实心的：
+        // 按这些外环的包围盒扩大范围重读一次。包含某个图元的环，其包围盒必然也与读取范围相交，
+        // 所以第一遍已经读到了所有外环及其祖先，重读后要输出的 group 不变。
+        // 裁剪到区域时伸出区域的部分会被切掉，不必重读
+        auto keep = [&](const PolyGroup &g)
+        {
+            if (shard.active())
+                return groupShard(shard, reader.polys, g) == shard.index;
+            return !options.clipToRegion && region->intersectsRing(reader.polys[g.outer].pts);
+        };
+        if (readRegion)
+        {
+            const Bounds &area = readArea.bounds();
+            Bounds grown = area;
+            for (const auto &g : grouping.groups)
+            {
+                if (!keep(g))
+                    continue;
+                const Bounds b = boundsOfRing(reader.polys[g.outer].pts);
+                grown.add(b.minX, b.minY);
+                grown.add(b.maxX, b.maxY);
+            }
+            if (grown.minX < area.minX || grown.minY < area.minY || grown.maxX > area.maxX || grown.maxY > area.maxY)
+            {
+                if (log)
+                    *log << "Groups extend past the read extent, re-reading with the grown extent\n";
+                readArea = Region::box(grown.minX, grown.minY, grown.maxX, grown.maxY);
+                reader = MyDXFReader(options.height, "");
+                status = loadGroups(filename, data, size, options, callbacks, readRegion, reader, grouping, report);
+                if (status != ConvertStatus::Ok)
+                    return status;
+            }
+        }
+        if (region)
+        {
+            // 读取阶段只按包围盒筛选，这里按外环精确判定；洞跟随外环（上面已保证读全），不必单独检查
+            const size_t before = grouping.groups.size();
+            grouping.groups.erase(std::remove_if(grouping.groups.begin(), grouping.groups.end(), [&](const PolyGroup &g)
+                                                 { return !region->intersectsRing(reader.polys[g.outer].pts); }),
+                                  grouping.groups.end());
+            if (log)
+                *log << "Region of interest: " << grouping.groups.size() << " of " << before << " groups intersect\n";
+        }
+        const float height = options.height;
+        if (options.cullSharedWalls)
+        {
+            // 目前所有 group 使用同一高度。分片时在筛掉其他分片的 group 之前构建，格子两侧相邻的建筑也能互相剔除
+            // （可能退化或裁剪时除外，见下）
+            TraceScope trace("cull shared walls");
+            walls.build(reader.polys, grouping, std::vector<float>(grouping.groups.size(), height), options.wallTolerance);
+        }
+        if (shard.active())
+        {
+            // 只输出外环包围盒中心落在本格子里的 group，跨越格子边界的 group 由且仅由一个分片输出
+            const size_t before = grouping.groups.size();
+            grouping.groups.erase(std::remove_if(grouping.groups.begin(), grouping.groups.end(), [&](const PolyGroup &g)
+                                                 { return groupShard(shard, reader.polys, g) != shard.index; }),
+                                  grouping.groups.end());
+            if (log)
+                *log << "Shard " << shard.index << "/" << shard.count << ": " << grouping.groups.size() << " of "
+                     << before << " groups owned\n";
+            // group 在三角化超出预算或被区域裁剪时改用新环生成侧面，convert 会补回邻居被剔除的墙，
+            // 但邻居属于其他分片时那个进程无从得知：可能退化或裁剪时，与其他分片的 group 共用的墙两侧都保留
+            const bool mayReplaceRings = options.triangulation.budget.maxIterations > 0 ||
+                                         options.triangulation.budget.maxMillis > 0 || (region && options.clipToRegion);
+            if (walls.culledEdges() > 0 && mayReplaceRings)
+            {
+                std::vector<char> owned(reader.polys.size(), 0);
+                for (const auto &g : grouping.groups)
+                {
+                    owned[g.outer] = 1;
+                    for (size_t k = 0; k < g.holeCount; k++)
+                        owned[grouping.holes[g.holeBegin + k]] = 1;
+                }
+                size_t kept = 0;
+                for (size_t poly = 0; poly < reader.polys.size(); poly++)
+                {
+                    for (size_t i = 0; owned[poly] && i < reader.polys[poly].pts.size(); i++)
+                    {
+                        if (!walls.culled(poly, i))
+                            continue;
+                        const auto partners = walls.partners(poly, i);
+                        if (std::any_of(partners.begin(), partners.end(), [&](const SharedWalls::Partner &p)
+                                        { return !owned[p.poly]; }))
+                        {
+                            walls.restore(poly, i);
+                            kept++;
+                        }
+                    }
+                }
+                if (log && kept > 0)
+                    *log << "Shard " << shard.index << "/" << shard.count << ": " << kept
+                         << " walls shared with other shards kept\n";
+            }
+        }
+        if (log)
+        {
+            const size_t hatchGroups = (size_t)std::count_if(reader.polys.begin(), reader.polys.end(), [](const RawPoly &p)
+                                                             { return p.role == RingRole::HatchOuter; });
+            *log << "Groups (outer with holes): " << grouping.groups.size();
+            if (hatchGroups > 0)
+                *log << " (" << hatchGroups << " from HATCH boundaries)";
+            *log << "\n";
+        }
+        if (options.hilbertOrder)
+        {
+            // 解析顺序在空间上基本是随机的，重排后相邻的建筑依次处理、写进编号相邻的文件
+            TraceScope trace("hilbert order");
+            sortGroupsByHilbert(reader.polys, grouping);
+        }
+        report.groups = grouping.groups.size();
+        reportProgress(callbacks, ConvertStage::Grouping, 1, 1);
+        return ConvertStatus::Ok;
+    }
+
+    ConvertStatus convert(const std::string *filename, const char *data, size_t size, const ConvertOptions &options,
+                          const ConvertCallbacks &callbacks, RunReport &report)
+    {
+        MyDXFReader reader(options.height, "");
+        PolyGrouping grouping;
+        SharedWalls walls;
+        const ConvertStatus status = prepareGroups(filename, data, size, options, callbacks, reader, grouping, walls, report);
+        if (status != ConvertStatus::Ok)
+            return status;
+        const Region *region = options.region.active() ? &options.region : nullptr;
+        const float height = options.height;
+
+        // For each group, build polygonRings (outer then holes), extrude and triangulate (earcut)
+        const size_t groupCount = grouping.groups.size();
+        reportProgress(callbacks, ConvertStage::Meshing, 0, groupCount);
+        // 已输出网格的多边形，相邻 group 退化时据此决定补墙的位置
+        std::vector<char> meshed(walls.culledEdges() > 0 ? reader.polys.size() : 0, 0);
+        size_t groupIdx = 0;
+        for (const auto &g : grouping.groups)
+        {
+            if (isCancelled(callbacks))
+                return ConvertStatus::Cancelled;
+            // 外环在前、洞在后，直接指向 reader.polys 中的顶点
+            RingList rings = grouping.rings(reader.polys, g);
+            // 跨越区域边界的 group 裁剪成区域内的若干块，各块分别三角化、拉伸后合成同一个网格
+            std::vector<std::vector<std::vector<Vertex>>> pieces;
+            const bool clipped = region && options.clipToRegion && !region->containsRing(rings[0]) &&
+                                 clipRingsToRegion(rings, region->outline(), pieces);
+
+            GroupMesh mesh;
+            mesh.index = groupIdx;
+            mesh.layer = reader.polys[g.outer].layer;
+            std::vector<Vertex> &tris = mesh.triangles;
+            std::string reason;
+            // fromGroup 为真时 rings 就是 g 的外环与洞，可以按原多边形查共用墙标记
+            auto meshRings = [&](RingList &rings, bool fromGroup)
+            {
+                const bool convex = fromGroup && g.holeCount == 0 && reader.polys[g.outer].shape != PolyShape::General;
+                std::vector<std::vector<Vertex>> fallbackRings;
+                // 利用earcut生成上下面的三角网格，超出预算时退化为抽稀环/凸包，rings 随之替换
+                CapFallback fallback;
+                std::string why;
+                {
+                    TraceScope trace("triangulate");
+                    size_t vertexCount = 0;
+                    for (const auto &ring : rings)
+                        vertexCount += ring.size();
+                    std::vector<Vertex> caps;
+                    fallback = triangulateWithFallback(rings, height, 0.0f, options.triangulation, caps, why, fallbackRings, convex);
+                    appendVerts(tris, caps);
+                    trace.arg("group", (int64_t)groupIdx).arg("vertices", (int64_t)vertexCount).arg("holes", (int64_t)(rings.size() - 1)).arg("triangles", (int64_t)(caps.size() / 3));
+                }
+                if (fallback != CapFallback::None && mesh.fallback == CapFallback::None)
+                {
+                    mesh.fallback = fallback;
+                    reason = why;
+                }
+                // 生成侧面三角形；退化或裁剪后的环与原多边形的边不再对应，不做共用墙剔除
+                TraceScope trace("extrude");
+                const size_t before = tris.size() / 3;
+                for (size_t k = 0; k < rings.size(); k++)
+                {
+                    const size_t poly = k == 0 ? g.outer : grouping.holes[g.holeBegin + k - 1];
+                    const char *culled = fromGroup && fallback == CapFallback::None ? walls.flagsFor(poly) : nullptr;
+                    auto side = generateSideTriangles(rings[k], height, culled);
+                    if (culled && rings[k].size() >= 2)
+                        report.culledWallTriangles += 2 * (size_t)std::count(culled, culled + rings[k].size(), 1);
+                    appendVerts(tris, side);
+                }
+                trace.arg("group", (int64_t)groupIdx).arg("rings", (int64_t)rings.size()).arg("triangles", (int64_t)(tris.size() / 3 - before));
+            };
+            if (!clipped)
+                meshRings(rings, true);
+            for (const auto &piece : pieces)
+            {
+                RingList pieceRings(piece);
+                meshRings(pieceRings, false);
+            }
+            if (mesh.fallback != CapFallback::None)
+                report.degraded.push_back({groupIdx, capFallbackName(mesh.fallback), reason});
+            // 退化或裁剪后的侧面不再沿原来的边生成，邻居剔除掉的那段墙要补回来：
+            // 还没输出的邻居取消剔除，已经输出的把它那段墙并入本 group 的网格
+            if (!meshed.empty())
+            {
+                const bool replaced = clipped || mesh.fallback != CapFallback::None;
+                for (size_t k = 0; k <= g.holeCount; k++)
+                {
+                    const size_t poly = k == 0 ? g.outer : grouping.holes[g.holeBegin + k - 1];
+                    for (size_t i = 0; replaced && i < reader.polys[poly].pts.size(); i++)
+                    {
+                        if (!walls.culled(poly, i))
+                            continue;
+                        for (const auto &p : walls.partners(poly, i))
+                        {
+                            if (!walls.culled(p.poly, p.edge))
+                                continue;
+                            walls.restore(p.poly, p.edge);
+                            if (meshed[p.poly])
+                            {
+                                static const char keepFirst[2] = {0, 1};
+                                appendVerts(tris, generateSideTriangles({p.a, p.b}, height, keepFirst));
+                                report.culledWallTriangles -= 2;
+                            }
+                        }
+                        // 本 group 的这条边没有被剔除，之后退化的邻居不必再为它补墙
+                        walls.restore(poly, i);
+                    }
+                    meshed[poly] = 1;
+                }
+            }
+            reader.releaseGroup(grouping, g);
+
+            report.triangles += tris.size() / 3;
+            if (callbacks.onGroup)
+                callbacks.onGroup(std::move(mesh));
+            reportProgress(callbacks, ConvertStage::Meshing, ++groupIdx, groupCount);
+        }
+        return ConvertStatus::Ok;
+    }
+} // namespace
+
+const char *convertStatusName(ConvertStatus s)
+{
+    switch (s)
+    {
+    case ConvertStatus::Ok:
+        return "ok";
+    case ConvertStatus::ReadFailed:
+        return "read failed";
+    case ConvertStatus::Cancelled:
+        return "cancelled";
+    }
+    return "";
+}
+
+ConvertStatus estimateCadFile(const std::string &filename, const ConvertOptions &options, const OutputOptions &output,
+                              CapacityEstimate &estimate, RunReport *report)
+{
+    RunReport local;
+    MyDXFReader reader(options.height, "");
+    PolyGrouping grouping;
+    SharedWalls walls;
+    const auto t0 = std::chrono::steady_clock::now();
+    const ConvertStatus status =
+        prepareGroups(&filename, nullptr, 0, options, {}, reader, grouping, walls, report ? *report : local);
+    if (status != ConvertStatus::Ok)
+        return status;
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    estimate = estimateCapacity(reader.polys, grouping, options.cullSharedWalls ? &walls : nullptr, options.height, output);
+    estimate.elapsedSeconds = elapsed;
+    std::error_code ec;
+    estimate.fileBytes = std::filesystem::file_size(filename, ec);
+    // 快速读取器把整个文件映射进内存
+    if (options.useFastReader && detectCadFileKind(filename) == CadFileKind::AsciiDxf)
+        estimate.inputBytes = estimate.fileBytes;
+    return ConvertStatus::Ok;
+}
+
+bool readCadExtents(const std::string &filename, const ConvertOptions &options, Bounds &extent)
+{
+    if (detectCadFileKind(filename) == CadFileKind::AsciiDxf && readHeaderExtents(filename, extent))
+        return true;
+    MyDXFReader reader(options.height, "");
+    reader.verbose = false;
+    if (!readSource(&filename, nullptr, 0, options, reader))
+        return false;
+    Bounds b;
+    for (const auto &p : reader.polys)
+        for (const auto &v : p.pts)
+            b.add(v.x, v.y);
+    if (b.empty())
+        return false;
+    extent = b;
+    return true;
+}
+
+ConvertStatus convertCadFile(const std::string &filename, const ConvertOptions &options,
+                             const ConvertCallbacks &callbacks, RunReport *report)
+{
+    RunReport local;
+    return convert(&filename, nullptr, 0, options, callbacks, report ? *report : local);
+}
+
+ConvertStatus convertCadBuffer(const char *data, size_t size, const ConvertOptions &options,
+                               const ConvertCallbacks &callbacks, RunReport *report)
+{
+    RunReport local;
+    return convert(nullptr, data, size, options, callbacks, report ? *report : local);
+}
@@ -0,0 +1,265 @@
+﻿#include "capacity.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <ostream>
+#include <unordered_set>
+
+namespace
+{
+    // 包含关系扫描每条边、每个多边形占用的字节：边本身、插入/删除事件（分段时另有一份拷贝）、
+    // 迭代器与红黑树节点；多边形为查询事件、探针、结果与包含树
+    constexpr uint64_t kSweepBytesPerEdge = 160;
+    constexpr uint64_t kSweepBytesPerPolygon = 80;
+    // earcut 每个顶点的链表节点（含 z-order 哈希字段）
+    constexpr uint64_t kEarcutBytesPerVertex = 80;
+    // 焊接时哈希表每个槽位
+    constexpr uint64_t kWeldBytesPerCorner = 40;
+    // 实测压缩率的样本大小
+    constexpr size_t kSampleBytes = 4u << 20;
+
+    // 与 exportGroupToOBJ 相同的 "v x y z" 行长度（std::ostream 输出 float 等同于 %g）
+    size_t vertexLineLength(float x, float y, float z)
+    {
+        char buf[96];
+        return (size_t)std::snprintf(buf, sizeof(buf), "v %g %g %g\n", x, y, z);
+    }
+
+    // 1..n 的十进制位数之和
+    uint64_t digitSum(uint64_t n)
+    {
+        uint64_t sum = 0;
+        for (uint64_t lo = 1, digits = 1; lo <= n; lo *= 10, digits++)
+            sum += (std::min(n, lo * 10 - 1) - lo + 1) * digits;
+        return sum;
+    }
+
+    struct VertexKeyHash
+    {
+        size_t operator()(const Vertex &v) const
+        {
+            uint32_t b[3];
+            std::memcpy(b, &v, sizeof(b));
+            return (size_t)b[0] * 73856093u ^ (size_t)b[1] * 19349663u ^ (size_t)b[2] * 83492791u;
+        }
+    };
+    struct VertexKeyEqual
+    {
+        bool operator()(const Vertex &a, const Vertex &b) const { return std::memcmp(&a, &b, sizeof(float) * 3) == 0; }
+    };
+    using VertexSet = std::unordered_set<Vertex, VertexKeyHash, VertexKeyEqual>;
+
+    // 在临时文件上用 options 的压缩格式写 text，返回落盘字节与原始字节之比
+    double measureCompression(const std::string &text, const OutputOptions &options)
+    {
+        if (text.empty())
+            return 1.0;
+        std::error_code ec;
+        const auto path = std::filesystem::temp_directory_path(ec) /
+                          ("cadproc_estimate_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+        if (ec)
+            return 1.0;
+        double ratio = 1.0;
+        {
+            OutputSink sink(path.string(), options);
+            std::ostream out(&sink);
+            out.write(text.data(), (std::streamsize)text.size());
+            out.flush();
+            if (sink.close() && sink.rawBytes() > 0)
+                ratio = (double)sink.storedBytes() / (double)sink.rawBytes();
+        }
+        std::filesystem::remove(path, ec);
+        return ratio;
+    }
+
+    double mb(uint64_t bytes)
+    {
+        return bytes / (1024.0 * 1024.0);
+    }
+} // namespace
+
+CapacityEstimate estimateCapacity(const std::vector<RawPoly> &polys, const PolyGrouping &grouping, const SharedWalls *walls,
+                                  float height, const OutputOptions &output)
+{
+    CapacityEstimate est;
+    est.polygons = polys.size();
+    est.groups = grouping.groups.size();
+    uint64_t sweepEdges = 0;
+    for (const auto &p : polys)
+    {
+        est.vertices += p.pts.size();
+        est.polygonBytes += sizeof(RawPoly) + p.pts.capacity() * sizeof(Vertex) + p.layer.capacity();
+        if (p.role == RingRole::Free)
+            sweepEdges += p.pts.size();
+    }
+    est.polygonBytes += grouping.groups.size() * sizeof(PolyGroup) + grouping.holes.size() * sizeof(size_t);
+    if (walls)
+        est.polygonBytes += est.vertices + polys.size() * sizeof(size_t);
+    est.sweepBytes = sweepEdges * kSweepBytesPerEdge + polys.size() * kSweepBytesPerPolygon;
+
+    // 各格式的原始字节数；顺带攒一段侧面的真实文本作为压缩率样本
+    uint64_t soupBytes = 0, indexedBytes = 0;
+    std::string soupSample, indexedSample;
+    char line[96];
+    VertexSet welded;
+    for (const auto &g : grouping.groups)
+    {
+        const RingList rings = grouping.rings(polys, g);
+        est.holes += g.holeCount;
+        uint64_t n = 0, holes = 0;
+        for (size_t k = 0; k < rings.size(); k++)
+        {
+            if (rings[k].size() < 3)
+                continue;
+            n += rings[k].size();
+            holes += k > 0;
+        }
+        const uint64_t caps = rings[0].size() >= 3 ? 2 * (n + 2 * holes - 2) : 0;
+        uint64_t sides = 0;
+        uint64_t capLineBytes = 0, sideLineBytes = 0;
+        welded.clear();
+        const bool sampleGroup = soupSample.size() < kSampleBytes;
+        std::vector<Vertex> sampleVerts;
+        for (size_t k = 0; k < rings.size(); k++)
+        {
+            const auto &ring = rings[k];
+            const size_t poly = k == 0 ? g.outer : grouping.holes[g.holeBegin + k - 1];
+            const char *culled = walls ? walls->flagsFor(poly) : nullptr;
+            for (size_t i = 0; i < ring.size(); i++)
+            {
+                const Vertex &v = ring[i];
+                // 顶/底面的 z 固定为 0 与 height，侧面沿用环上的 z
+                if (ring.size() >= 3 && (k == 0 || rings[0].size() >= 3))
+                {
+                    capLineBytes += vertexLineLength(v.x, v.y, 0.0f) + vertexLineLength(v.x, v.y, height);
+                    welded.insert({v.x, v.y, 0.0f});
+                    welded.insert({v.x, v.y, height});
+                }
+                if (ring.size() < 2)
+                    continue;
+                if (culled && culled[i])
+                {
+                    est.culledWallTriangles += 2;
+                    continue;
+                }
+                const Vertex &w = ring[(i + 1) % ring.size()];
+                const Vertex b0 = v, t0 = {v.x, v.y, v.z + height}, b1 = w, t1 = {w.x, w.y, w.z + height};
+                sides += 2;
+                sideLineBytes += 2 * vertexLineLength(b0.x, b0.y, b0.z) + vertexLineLength(t0.x, t0.y, t0.z) +
+                                 2 * vertexLineLength(t1.x, t1.y, t1.z) + vertexLineLength(b1.x, b1.y, b1.z);
+                welded.insert(b0);
+                welded.insert(t0);
+                if (sampleGroup)
+                    for (const Vertex &s : {b0, t0, t1, b0, t1, b1})
+                        sampleVerts.push_back(s);
+            }
+        }
+        const uint64_t tris = caps + sides;
+        est.capTriangles += caps;
+        est.sideTriangles += sides;
+        est.largestGroupTriangles = std::max(est.largestGroupTriangles, tris);
+        if (tris == 0)
+            continue;
+
+        // 三角形汤：侧面顶点逐个精确计，顶/底面顶点按环上顶点的平均行长计；面行 "f a b c" 精确计
+        const uint64_t ringCount = n > 0 ? n : 1;
+        soupBytes += sideLineBytes + caps * 3 * capLineBytes / (2 * ringCount) + digitSum(3 * tris) + 5 * tris;
+        // 索引网格：焊接后的顶点逐个精确计，面行的下标位数按 1..V 的平均值计
+        const uint64_t v = welded.size();
+        est.weldedVertices += v;
+        for (const auto &w : welded)
+            indexedBytes += vertexLineLength(w.x, w.y, w.z);
+        indexedBytes += 5 * tris + 3 * tris * digitSum(v) / std::max<uint64_t>(v, 1);
+
+        // 最大的一个 group 的网格：顶/底面与合并后的三角形各一份，加上 earcut 链表与下标
+        uint64_t mesh = 2 * tris * 3 * sizeof(Vertex) + n * kEarcutBytesPerVertex + caps / 2 * 3 * sizeof(uint32_t);
+        if (output.optimizeMesh)
+            mesh += v * sizeof(Vertex) + tris * 3 * (sizeof(uint32_t) + kWeldBytesPerCorner);
+        est.meshBytes = std::max(est.meshBytes, mesh);
+
+        if (sampleGroup)
+        {
+            // 样本只含侧面：顶/底面依赖三角化结果，二者的文本形式相同
+            for (const auto &s : sampleVerts)
+                soupSample.append(line, (size_t)std::snprintf(line, sizeof(line), "v %g %g %g\n", s.x, s.y, s.z));
+            for (size_t i = 0; i < sampleVerts.size(); i += 3)
+                soupSample.append(line, (size_t)std::snprintf(line, sizeof(line), "f %zu %zu %zu\n", i + 1, i + 2, i + 3));
+            for (const auto &w : welded)
+                indexedSample.append(line, (size_t)std::snprintf(line, sizeof(line), "v %g %g %g\n", w.x, w.y, w.z));
+            for (size_t i = 0; i < sampleVerts.size() / 3; i++)
+                indexedSample.append(line, (size_t)std::snprintf(line, sizeof(line), "f %zu %zu %zu\n", i % v + 1,
+                                                                 (i + 1) % v + 1, (i + 2) % v + 1));
+        }
+    }
+
+    const struct
+    {
+        const char *name;
+        OutputCompression compression;
+    } codecs[] = {{"", OutputCompression::None}, {" + gzip", OutputCompression::Gzip}, {" + zstd", OutputCompression::Zstd}};
+    for (const bool indexed : {false, true})
+    {
+        for (const auto &codec : codecs)
+        {
+            FormatEstimate f;
+            f.name = std::string(indexed ? "indexed OBJ" : "OBJ") + codec.name;
+            f.rawBytes = indexed ? indexedBytes : soupBytes;
+            f.available = outputCompressionAvailable(codec.compression);
+            if (f.available)
+            {
+                OutputOptions options;
+                options.compression = codec.compression;
+                options.level = output.level;
+                const double ratio = codec.compression == OutputCompression::None
+                                         ? 1.0
+                                         : measureCompression(indexed ? indexedSample : soupSample, options);
+                f.storedBytes = (uint64_t)(f.rawBytes * ratio);
+            }
+            est.formats.push_back(f);
+        }
+    }
+    return est;
+}
+
+uint64_t CapacityEstimate::peakMemory() const
+{
+    // 读取、分组、拉伸三个阶段各自的占用，取最大者
+    const uint64_t reading = inputBytes + polygonBytes;
+    const uint64_t grouping = polygonBytes + sweepBytes;
+    const uint64_t meshing = polygonBytes + meshBytes + writerBytes;
+    return std::max({reading, grouping, meshing});
+}
+
+void CapacityEstimate::print(std::ostream &os) const
+{
+    os << std::fixed << std::setprecision(1);
+    os << "---------------- Dry run ----------------\n";
+    os << "Input           : " << fileBytes << " bytes\n";
+    os << "Polygons        : " << polygons << " (" << vertices << " vertices)\n";
+    os << "Groups          : " << groups << " (" << holes << " holes)\n";
+    os << "Triangles       : " << triangles() << " (caps " << capTriangles << ", sides " << sideTriangles;
+    if (culledWallTriangles > 0)
+        os << ", " << culledWallTriangles << " culled";
+    os << ")\n";
+    os << "Vertices        : " << soupVertices() << " as triangle soup, " << weldedVertices << " welded\n";
+    os << "Largest group   : " << largestGroupTriangles << " triangles\n";
+    os << "Read + group    : " << std::setprecision(3) << elapsedSeconds << " s\n" << std::setprecision(1);
+    os << "Peak memory     : ~" << mb(peakMemory()) << " MB (input " << mb(inputBytes) << ", polygons " << mb(polygonBytes)
+       << ", containment sweep " << mb(sweepBytes) << ", largest mesh " << mb(meshBytes) << ", writer queue "
+       << mb(writerBytes) << ")\n";
+    os << "Output bytes    :\n";
+    for (const auto &f : formats)
+    {
+        os << "  " << std::left << std::setw(22) << f.name << std::right;
+        if (!f.available)
+            os << "not available in this build\n";
+        else if (f.storedBytes == f.rawBytes)
+            os << f.rawBytes << " (~" << mb(f.rawBytes) << " MB)\n";
+        else
+            os << "~" << f.storedBytes << " (~" << mb(f.storedBytes) << " MB, " << f.rawBytes << " uncompressed)\n";
+    }
+    os << std::defaultfloat;
+}
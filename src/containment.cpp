@@ -0,0 +1,644 @@
+﻿#include "containment.h"
+#include "predicates.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <set>
+#include <thread>
+
+namespace
+{
+    // 扫描线上的一条非竖直边，左端点 (lx, ly)，右端点 (rx, ry)。
+    // 顶点本身是 float，按 float 保存不损失精度，计算时再提升为 double。
+    // chain >= 0 时代表凸多边形的整条上链或下链，(lx, ly)、(rx, ry) 为链的两端
+    struct SweepEdge
+    {
+        float lx, ly, rx, ry;
+        int32_t poly;
+        // 0：边的下方是多边形内部（上边界）；1：面积为 0 的退化多边形；2：边的上方是内部（下边界）
+        int32_t side;
+        int32_t chain = -1;
+
+        double yAt(double x) const
+        {
+            if (x <= lx)
+                return ly;
+            if (x >= rx)
+                return ry;
+            return (double)ly + ((double)ry - ly) * (x - lx) / ((double)rx - lx);
+        }
+        double slope() const { return ((double)ry - ly) / ((double)rx - lx); }
+    };
+
+    struct ChainPoint
+    {
+        float x, y;
+    };
+
+    // x 单调的顶点链（按 x 递增）。凸多边形只有上、下两条链，整条链作为一个扫描对象，
+    // 事件数从每条边两个降到每条链两个。radius > 0 的链来自 makeCirclePoly 的圆，顶点等角分布
+    struct SweepChain
+    {
+        uint32_t begin, count; // 顶点在 SweepShapes::points 中的范围
+        float cx, cy, radius;
+    };
+
+    struct SweepShapes
+    {
+        std::vector<SweepChain> chains;
+        std::vector<ChainPoint> points;
+
+        // x 所在段的起点（相对 begin）：x 落在 [p[k].x, p[k + 1].x) 内，x 为右端点时取最后一段
+        size_t segmentAt(const SweepChain &c, double x) const
+        {
+            const ChainPoint *p = &points[c.begin];
+            const size_t last = c.count - 2;
+            if (c.radius > 0)
+            {
+                // 圆：第 k 个顶点位于角度 π(1 - k / (count - 1))（上链）处，由 x 反解出段号，
+                // 顶点坐标经过 float 舍入，估计值可能差一段，再就近修正
+                const double t = std::min(1.0, std::max(-1.0, (x - c.cx) / c.radius));
+                size_t k = (size_t)((M_PI - std::acos(t)) / M_PI * (double)(c.count - 1));
+                k = std::min(k, last);
+                while (k > 0 && p[k].x > x)
+                    k--;
+                while (k < last && p[k + 1].x <= x)
+                    k++;
+                return k;
+            }
+            const ChainPoint *it = std::upper_bound(p, p + c.count - 1, x, [](double v, const ChainPoint &q)
+                                                    { return v < q.x; });
+            return std::min((size_t)(it - p), last + 1) - 1;
+        }
+        double yAt(const SweepEdge &e, double x) const
+        {
+            if (e.chain < 0)
+                return e.yAt(x);
+            if (x <= e.lx)
+                return e.ly;
+            if (x >= e.rx)
+                return e.ry;
+            const SweepChain &c = chains[e.chain];
+            const ChainPoint *p = &points[c.begin + segmentAt(c, x)];
+            // 与单条边的 yAt 用同一公式，结果与逐边扫描一致
+            return (double)p[0].y + ((double)p[1].y - p[0].y) * (x - p[0].x) / ((double)p[1].x - p[0].x);
+        }
+        // 扫描线右侧无穷小处的斜率
+        double slope(const SweepEdge &e, double x) const
+        {
+            if (e.chain < 0)
+                return e.slope();
+            const SweepChain &c = chains[e.chain];
+            const ChainPoint *p = &points[c.begin + segmentAt(c, std::min(std::max(x, (double)e.lx), (double)e.rx))];
+            return ((double)p[1].y - p[0].y) / ((double)p[1].x - p[0].x);
+        }
+        // x 处（右侧无穷小）所在线段，端点按 x 递增
+        void segment(const SweepEdge &e, double x, double (&s)[4]) const
+        {
+            if (e.chain < 0)
+            {
+                s[0] = e.lx, s[1] = e.ly, s[2] = e.rx, s[3] = e.ry;
+                return;
+            }
+            const SweepChain &c = chains[e.chain];
+            const ChainPoint *p = &points[c.begin + segmentAt(c, std::min(std::max(x, (double)e.lx), (double)e.rx))];
+            s[0] = p[0].x, s[1] = p[0].y, s[2] = p[1].x, s[3] = p[1].y;
+        }
+        // 点 (x, y) 在 x 处线段的上方为正、下方为负、线段上为 0，符号精确
+        double side(const SweepEdge &e, double x, double y) const
+        {
+            double s[4];
+            segment(e, x, s);
+            return orient2d(s[0], s[1], s[2], s[3], x, y);
+        }
+        // 两条边在 x 右侧无穷小处的斜率比较：a 更陡（向上）为正。float 坐标之差用 double 计算不丢精度
+        // （两坐标量级相近时），斜率相等的公共边能被精确识别
+        double compareSlope(const SweepEdge &a, const SweepEdge &b, double x) const
+        {
+            double sa[4], sb[4];
+            segment(a, x, sa);
+            segment(b, x, sb);
+            return orient2d(0, 0, sb[2] - sb[0], sb[3] - sb[1], sa[2] - sa[0], sa[3] - sa[1]);
+        }
+    };
+
+    // 查询点：求其正上方的第一条边。(dx, dy) 为查询多边形在该点处下侧边的方向（dx > 0），
+    // 查询点恰好落在别的边上（共享顶点、贴边）时，按它判断那条边在多边形内部的上方还是下方
+    struct SweepProbe
+    {
+        double y;
+        double dx = 1, dy = 0;
+    };
+
+    // 按扫描线 x 右侧无穷小处的 y 值排序。互不相交的边在各自存活期间相对次序不变，
+    // 所以即使比较依赖当前 x，std::set 的有序性依然成立
+    struct EdgeOrder
+    {
+        using is_transparent = void;
+        const std::vector<SweepEdge> *edges;
+        const SweepShapes *shapes;
+        const double *sweepX;
+
+        bool operator()(int a, int b) const
+        {
+            const SweepEdge &ea = (*edges)[a];
+            const SweepEdge &eb = (*edges)[b];
+            const double x = *sweepX;
+            // 插入时新边的左端点就在扫描线上，与另一条边的上下关系用精确的 orient2d 判定，
+            // 共享顶点、端点落在别的边上时不受插值舍入影响
+            if (eb.lx == x && ea.lx != x)
+            {
+                const double o = shapes->side(ea, x, eb.ly);
+                if (o != 0)
+                    return o > 0;
+            }
+            else if (ea.lx == x && eb.lx != x)
+            {
+                const double o = shapes->side(eb, x, ea.ly);
+                if (o != 0)
+                    return o < 0;
+            }
+            else
+            {
+                double ya = shapes->yAt(ea, x), yb = shapes->yAt(eb, x);
+                if (ya != yb)
+                    return ya < yb;
+            }
+            const double slope = shapes->compareSlope(ea, eb, x);
+            if (slope != 0)
+                return slope < 0;
+            // 重合的公共边：内部在下方的边更“靠下”，使射线先碰到包住查询点的那个多边形
+            if (ea.side != eb.side)
+                return ea.side < eb.side;
+            return a < b;
+        }
+        bool above(const SweepEdge &e, const SweepProbe &p) const
+        {
+            const double o = shapes->side(e, *sweepX, p.y);
+            if (o != 0)
+                return o < 0;
+            // 边经过查询点：比下侧边更陡才在多边形内部的上方，与下侧边共线的公共边算在下方
+            double s[4];
+            shapes->segment(e, *sweepX, s);
+            return orient2d(0, 0, p.dx, p.dy, s[2] - s[0], s[3] - s[1]) > 0;
+        }
+        // 边经过查询点且与下侧边共线；starts 表示这段边正好从查询点出发
+        bool alongLower(const SweepEdge &e, const SweepProbe &p, bool &starts) const
+        {
+            double s[4];
+            shapes->segment(e, *sweepX, s);
+            if (orient2d(s[0], s[1], s[2], s[3], *sweepX, p.y) != 0 ||
+                orient2d(0, 0, p.dx, p.dy, s[2] - s[0], s[3] - s[1]) != 0)
+                return false;
+            starts = s[0] == *sweepX && s[1] == p.y;
+            return true;
+        }
+        bool operator()(int a, const SweepProbe &p) const { return !above((*edges)[a], p); }
+        bool operator()(const SweepProbe &p, int b) const { return above((*edges)[b], p); }
+    };
+
+    enum EventType
+    {
+        Remove = 0,
+        Insert = 1,
+        Query = 2
+    };
+
+    // 事件只占 16 字节：类型放在 id 的高 2 位，查询点的 y 另存在按多边形下标的数组里
+    struct SweepEvent
+    {
+        double x;
+        uint32_t packed;
+
+        SweepEvent(double x_, EventType type, uint32_t id) : x(x_), packed((uint32_t)type << 30 | id) {}
+        EventType type() const { return (EventType)(packed >> 30); }
+        uint32_t id() const { return packed & 0x3fffffffu; } // 边下标或多边形下标
+    };
+
+    // 射线结果：多边形落在某多边形内部，或与某多边形同层（父级相同）
+    enum RelationKind
+    {
+        Outside,
+        InsideOf,
+        SiblingOf
+    };
+
+    // 把凸多边形拆成上、下两条 x 单调链，左右两端的竖直边不属于任何一条链。
+    // 数值误差使链不单调时返回 false，调用方改为逐边加入
+    bool splitConvex(const RawPoly &poly, SweepShapes &shapes, SweepChain (&out)[2])
+    {
+        const auto &pts = poly.pts;
+        const size_t n = pts.size();
+        size_t left = 0, right = 0;
+        for (size_t i = 1; i < n; i++)
+        {
+            if (pts[i].x < pts[left].x)
+                left = i;
+            if (pts[i].x > pts[right].x)
+                right = i;
+        }
+        if (pts[left].x == pts[right].x)
+            return false;
+        // 逆时针时 left -> right 沿下边走，顺时针时沿上边走
+        std::vector<ChainPoint> forward, backward;
+        for (size_t i = left;; i = (i + 1) % n)
+        {
+            forward.push_back({pts[i].x, pts[i].y});
+            if (i == right)
+                break;
+        }
+        for (size_t i = left;; i = (i + n - 1) % n)
+        {
+            backward.push_back({pts[i].x, pts[i].y});
+            if (i == right)
+                break;
+        }
+        for (auto *chain : {&forward, &backward})
+        {
+            auto &c = *chain;
+            // 去掉两端竖直边上多余的点
+            size_t b = 0, e = c.size();
+            while (e - b > 2 && c[b + 1].x == c[b].x)
+                b++;
+            while (e - b > 2 && c[e - 2].x == c[e - 1].x)
+                e--;
+            c.assign(c.begin() + b, c.begin() + e);
+            for (size_t i = 1; i < c.size(); i++)
+                if (c[i].x < c[i - 1].x)
+                    return false;
+            if (c.size() < 2 || c.front().x == c.back().x)
+                return false;
+        }
+        const bool circle = poly.shape == PolyShape::Circle;
+        const bool ccw = poly.area > 0;
+        const std::vector<ChainPoint> *chains[2] = {ccw ? &backward : &forward, ccw ? &forward : &backward};
+        for (int k = 0; k < 2; k++) // out[0] 为上链，out[1] 为下链
+        {
+            out[k] = {(uint32_t)shapes.points.size(), (uint32_t)chains[k]->size(),
+                      poly.cx, poly.cy, circle ? poly.radius : 0.0f};
+            shapes.points.insert(shapes.points.end(), chains[k]->begin(), chains[k]->end());
+        }
+        return true;
+    }
+    // 多线程时每段至少分到这么多多边形，段太小时预放跨段边的开销会超过并行的收益
+    constexpr size_t kMinSlabQueries = 2048;
+    // 收集边时每块的多边形数
+    constexpr size_t kPolysPerPiece = 4096;
+
+    // 把 [0, count) 的任务交给 threads 个线程按下标领取，调用线程也参与
+    template <class Fn>
+    void parallelFor(size_t count, unsigned threads, const Fn &fn)
+    {
+        std::atomic<size_t> next{0};
+        auto worker = [&]()
+        {
+            for (size_t i; (i = next.fetch_add(1)) < count;)
+                fn(i);
+        };
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < std::min<size_t>(threads, count); t++)
+            pool.emplace_back(worker);
+        worker();
+        for (auto &t : pool)
+            t.join();
+    }
+
+    // 一块连续多边形收集出的边与凸链（下标都是块内的），拼接时再加上各块的偏移。
+    // events[s] 为落在第 s 段的事件，spanning[s] 为跨过第 s 段起点的边
+    struct SweepPiece
+    {
+        std::vector<SweepEdge> edges;
+        SweepShapes shapes;
+        size_t edgeOffset = 0, chainOffset = 0, pointOffset = 0;
+        std::vector<std::vector<SweepEvent>> events;
+        std::vector<std::vector<int>> spanning;
+    };
+
+    // 把多边形 k 的边（凸环为上下两条链）追加到 piece，并填好它的查询点
+    void collectPolygon(const RawPoly &poly, int32_t k, SweepPiece &piece, SweepProbe &probe, float &queryX)
+    {
+        const auto &pts = poly.pts;
+        const size_t n = pts.size();
+        if (n < 2 || poly.role != RingRole::Free)
+            return; // HATCH 的环自带外环/洞结构，不参与扫描
+        const bool ccw = poly.area > 0;
+        size_t leftmost = 0;
+        for (size_t i = 1; i < n; i++)
+            if (pts[i].x < pts[leftmost].x || (pts[i].x == pts[leftmost].x && pts[i].y < pts[leftmost].y))
+                leftmost = i;
+        queryX = pts[leftmost].x;
+        probe.y = pts[leftmost].y;
+        // 最左顶点的两条邻边（跳过重合点）都朝右或竖直向上，取更平缓的一条作为下侧边
+        const Vertex &o = pts[leftmost];
+        double dir[2][2] = {{0, 0}, {0, 0}};
+        for (int side = 0; side < 2; side++)
+        {
+            for (size_t step = 1; step < n; step++)
+            {
+                const Vertex &q = pts[side == 0 ? (leftmost + step) % n : (leftmost + n - step) % n];
+                if (q.x != o.x || q.y != o.y)
+                {
+                    dir[side][0] = (double)q.x - o.x, dir[side][1] = (double)q.y - o.y;
+                    break;
+                }
+            }
+        }
+        const int lower = orient2d(0, 0, dir[0][0], dir[0][1], dir[1][0], dir[1][1]) > 0 ? 0 : 1;
+        if (dir[lower][0] > 0)
+            probe.dx = dir[lower][0], probe.dy = dir[lower][1];
+
+        // 凸多边形与圆：上下两条链各作为一个扫描对象，链上的 y 按段插值（圆由 x 直接算出段号）
+        SweepShapes &shapes = piece.shapes;
+        SweepChain halves[2];
+        if (poly.shape != PolyShape::General && poly.area != 0 && splitConvex(poly, shapes, halves))
+        {
+            for (int h = 0; h < 2; h++)
+            {
+                const SweepChain &c = halves[h];
+                const ChainPoint &first = shapes.points[c.begin], &last = shapes.points[c.begin + c.count - 1];
+                SweepEdge e;
+                e.lx = first.x, e.ly = first.y, e.rx = last.x, e.ry = last.y;
+                e.poly = k;
+                e.side = h == 0 ? 0 : 2;
+                e.chain = (int32_t)shapes.chains.size();
+                shapes.chains.push_back(c);
+                piece.edges.push_back(e);
+            }
+            return;
+        }
+
+        for (size_t i = 0; i < n; i++)
+        {
+            const Vertex &a = pts[i];
+            const Vertex &b = pts[(i + 1) % n];
+            if (a.x == b.x)
+                continue; // 竖直边不影响向上射线的结果
+            const bool goingRight = a.x < b.x;
+            SweepEdge e;
+            e.poly = k;
+            if (goingRight)
+                e.lx = a.x, e.ly = a.y, e.rx = b.x, e.ry = b.y;
+            else
+                e.lx = b.x, e.ly = b.y, e.rx = a.x, e.ry = a.y;
+            // 逆时针多边形内部在有向边左侧：向右走的边内部在上方
+            if (poly.area == 0)
+                e.side = 1;
+            else
+                e.side = (goingRight == ccw) ? 2 : 0;
+            piece.edges.push_back(e);
+        }
+    }
+
+    // 分段扫描的只读输入
+    struct SweepContext
+    {
+        const std::vector<SweepEdge> &edges;
+        const SweepShapes &shapes;
+        const std::vector<SweepProbe> &probes;
+        size_t polyCount;
+    };
+
+    // 扫描一段：起点 x0 处先放入跨过它的边（spanning，按下标递增），再依次处理段内已排序的事件。
+    // 同一 x 上先删除、再插入，最后在 x 右侧无穷小处做查询。
+    // handles 只写段内插入的边，kind/relatedTo 只写段内查询的多边形，不同段之间互不干扰
+    void sweepSlab(const SweepContext &ctx, double x0, const std::vector<SweepEvent> &events,
+                   const std::vector<int> &spanning, std::vector<std::set<int, EdgeOrder>::iterator> &handles,
+                   std::vector<RelationKind> &kind, std::vector<int> &relatedTo, std::vector<int> &coincidentWith)
+    {
+        const auto &edges = ctx.edges;
+        const auto &probes = ctx.probes;
+        double sweepX = x0;
+        std::set<int, EdgeOrder> status(EdgeOrder{&edges, &ctx.shapes, &sweepX});
+        const EdgeOrder order = status.key_comp();
+        std::vector<std::set<int, EdgeOrder>::iterator> spanHandles;
+        spanHandles.reserve(spanning.size());
+        for (int id : spanning)
+            spanHandles.push_back(status.insert(id).first);
+
+        for (const SweepEvent &ev : events)
+        {
+            sweepX = ev.x;
+            const int id = (int)ev.id();
+            switch (ev.type())
+            {
+            case Remove:
+                if (edges[id].lx >= x0)
+                    status.erase(handles[id]);
+                else if (edges[id].rx > x0)
+                    status.erase(spanHandles[std::lower_bound(spanning.begin(), spanning.end(), id) - spanning.begin()]);
+                break; // 其余是在 x0 处结束、不在本段状态里的边
+            case Insert:
+                handles[id] = status.insert(id).first;
+                break;
+            case Query:
+            {
+                auto it = status.lower_bound(probes[id]);
+                // 下侧边与查询多边形在同一点出发、方向相同的多边形（重复或叠放的副本）视同自身，
+                // 否则两个相同的多边形会互相包含。这些边共线经过查询点，排在 lower_bound 之前
+                for (auto back = it; back != status.begin();)
+                {
+                    bool starts = false;
+                    if (!order.alongLower(edges[*--back], probes[id], starts))
+                        break;
+                    if (starts && edges[*back].poly != id)
+                    {
+                        if (coincidentWith.empty())
+                            coincidentWith.assign(ctx.polyCount, -1);
+                        coincidentWith[edges[*back].poly] = id;
+                    }
+                }
+                auto skipped = [&](int poly)
+                { return poly == id || (!coincidentWith.empty() && coincidentWith[poly] == id); };
+                while (it != status.end() && skipped(edges[*it].poly))
+                    ++it; // 跳过自身与重合多边形的边
+                if (it == status.end())
+                    break;
+                // 完全重合的边（叠放的副本）按下标相邻：取下标小于查询多边形的最后一个，
+                // 让每份副本的洞挂到同一份副本的外环上，而不是全部挂到第一份上
+                const SweepEdge &first = edges[*it];
+                for (auto next = std::next(it); next != status.end(); ++next)
+                {
+                    const SweepEdge &d = edges[*next];
+                    if (d.lx != first.lx || d.ly != first.ly || d.rx != first.rx || d.ry != first.ry || d.side != first.side)
+                        break;
+                    if (d.poly < id && !skipped(d.poly))
+                        it = next;
+                }
+                const SweepEdge &e = edges[*it];
+                kind[id] = e.side == 0 ? InsideOf : SiblingOf;
+                relatedTo[id] = e.poly;
+                break;
+            }
+            }
+        }
+    }
+} // namespace
+
+ContainmentTree buildContainmentTree(const std::vector<RawPoly> &polys, unsigned threads)
+{
+    const size_t m = polys.size();
+    ContainmentTree tree;
+    tree.parent.assign(m, -1);
+    tree.depth.assign(m, 0);
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // 按 x 切成若干段，各段独立扫描（见 sweepSlab），由线程池按段领取；每个查询只属于一段，
+    // 结果与单线程扫描逐项相同。段的边界取顶点 x 的分位数，使各段的事件数大致相当
+    const size_t slabTarget = threads <= 1 ? 1 : std::min<size_t>(threads * 4, std::max<size_t>(1, m / kMinSlabQueries));
+    std::vector<double> bounds{-std::numeric_limits<double>::infinity()}; // 第 s 段为 [bounds[s], bounds[s + 1])
+    if (slabTarget > 1)
+    {
+        std::vector<float> sample;
+        const size_t stride = std::max<size_t>(1, m / (slabTarget * 64));
+        for (size_t k = 0; k < m; k += stride)
+            for (const auto &v : polys[k].pts)
+                sample.push_back(v.x);
+        std::sort(sample.begin(), sample.end());
+        for (size_t s = 1; s < slabTarget; s++)
+        {
+            const double x = sample[sample.size() * s / slabTarget];
+            if (x > bounds.back())
+                bounds.push_back(x);
+        }
+    }
+    const size_t slabs = bounds.size();
+    auto slabOf = [&](double x)
+    { return (size_t)(std::upper_bound(bounds.begin() + 1, bounds.end(), x) - bounds.begin()) - 1; };
+
+    // 收集：按块并行生成边与凸链，再按块顺序拼接成全局下标（与逐个多边形顺序收集的结果相同）
+    const size_t pieceCount = (m + kPolysPerPiece - 1) / kPolysPerPiece;
+    std::vector<SweepPiece> pieces(pieceCount);
+    std::vector<SweepProbe> probes(m); // 每个多边形最左顶点的 y 与下侧边方向
+    std::vector<float> queryX(m, std::numeric_limits<float>::quiet_NaN()); // 不参与扫描的多边形为 NaN
+    parallelFor(pieceCount, threads, [&](size_t c)
+                {
+                    const size_t end = std::min(m, (c + 1) * kPolysPerPiece);
+                    for (size_t k = c * kPolysPerPiece; k < end; k++)
+                        collectPolygon(polys[k], (int32_t)k, pieces[c], probes[k], queryX[k]); });
+    size_t edgeCount = 0, chainCount = 0, pointCount = 0;
+    for (auto &piece : pieces)
+    {
+        piece.edgeOffset = edgeCount, piece.chainOffset = chainCount, piece.pointOffset = pointCount;
+        edgeCount += piece.edges.size();
+        chainCount += piece.shapes.chains.size();
+        pointCount += piece.shapes.points.size();
+    }
+    std::vector<SweepEdge> edges(edgeCount);
+    SweepShapes shapes;
+    shapes.chains.resize(chainCount);
+    shapes.points.resize(pointCount);
+
+    // 拼接的同时把事件分到各段：插入、删除分别落在 lx、rx 所在段，lx < 段起点 < rx 的边记为跨段边
+    parallelFor(pieceCount, threads, [&](size_t c)
+                {
+                    SweepPiece &piece = pieces[c];
+                    piece.events.resize(slabs);
+                    piece.spanning.resize(slabs);
+                    for (size_t i = 0; i < piece.shapes.chains.size(); i++)
+                    {
+                        SweepChain chain = piece.shapes.chains[i];
+                        chain.begin += (uint32_t)piece.pointOffset;
+                        shapes.chains[piece.chainOffset + i] = chain;
+                    }
+                    std::copy(piece.shapes.points.begin(), piece.shapes.points.end(), shapes.points.begin() + piece.pointOffset);
+                    for (size_t i = 0; i < piece.edges.size(); i++)
+                    {
+                        SweepEdge e = piece.edges[i];
+                        if (e.chain >= 0)
+                            e.chain += (int32_t)piece.chainOffset;
+                        const uint32_t id = (uint32_t)(piece.edgeOffset + i);
+                        edges[id] = e;
+                        const size_t sl = slabOf(e.lx), sr = slabOf(e.rx);
+                        piece.events[sl].emplace_back(e.lx, Insert, id);
+                        piece.events[sr].emplace_back(e.rx, Remove, id);
+                        for (size_t s = sl + 1; s <= sr && bounds[s] < e.rx; s++)
+                            piece.spanning[s].push_back((int)id);
+                    }
+                    const size_t end = std::min(m, (c + 1) * kPolysPerPiece);
+                    for (size_t k = c * kPolysPerPiece; k < end; k++)
+                        if (!std::isnan(queryX[k]))
+                            piece.events[slabOf(queryX[k])].emplace_back(queryX[k], Query, (uint32_t)k);
+                    piece.edges = std::vector<SweepEdge>();
+                    piece.shapes = SweepShapes(); });
+
+    // 扫描：每段汇总各块的事件后排序，同一 x 上按类型、再按下标；类型在 packed 的高位，直接比较 packed 即可
+    SweepContext ctx{edges, shapes, probes, m};
+    std::vector<std::set<int, EdgeOrder>::iterator> handles(edges.size());
+    std::vector<RelationKind> kind(m, Outside);
+    std::vector<int> relatedTo(m, -1);
+    parallelFor(slabs, threads, [&](size_t s)
+                {
+                    TraceScope trace("containment slab");
+                    std::vector<SweepEvent> events;
+                    std::vector<int> spanning;
+                    for (auto &piece : pieces)
+                    {
+                        events.insert(events.end(), piece.events[s].begin(), piece.events[s].end());
+                        spanning.insert(spanning.end(), piece.spanning[s].begin(), piece.spanning[s].end());
+                        piece.events[s] = std::vector<SweepEvent>();
+                        piece.spanning[s] = std::vector<int>();
+                    }
+                    std::sort(events.begin(), events.end(), [](const SweepEvent &a, const SweepEvent &b)
+                              {
+                                  if (a.x != b.x)
+                                      return a.x < b.x;
+                                  return a.packed < b.packed; });
+                    std::vector<int> coincidentWith; // 首次遇到重合多边形时才分配
+                    sweepSlab(ctx, bounds[s], events, spanning, handles, kind, relatedTo, coincidentWith);
+                    trace.arg("slab", (int64_t)s).arg("events", (int64_t)events.size()).arg("spanning", (int64_t)spanning.size()); });
+
+    // 把“与某多边形同层”的关系沿链解析成真正的父级
+    std::vector<char> resolved(m, 0);
+    std::vector<int> chain;
+    for (size_t k = 0; k < m; k++)
+    {
+        int cur = (int)k;
+        chain.clear();
+        while (cur >= 0 && !resolved[cur])
+        {
+            chain.push_back(cur);
+            resolved[cur] = 2; // 处理中，防止异常输入形成环
+            if (kind[cur] != SiblingOf)
+                break;
+            cur = relatedTo[cur];
+        }
+        // 从链尾往回赋值
+        for (size_t c = chain.size(); c-- > 0;)
+        {
+            int node = chain[c];
+            if (kind[node] == InsideOf)
+                tree.parent[node] = relatedTo[node];
+            else if (kind[node] == SiblingOf)
+            {
+                int sib = relatedTo[node];
+                tree.parent[node] = (resolved[sib] == 1) ? tree.parent[sib] : -1;
+            }
+            resolved[node] = 1;
+        }
+    }
+
+    // 深度：沿父链向上，同样用显式的链避免深递归
+    std::vector<char> depthDone(m, 0);
+    for (size_t k = 0; k < m; k++)
+    {
+        int cur = (int)k;
+        chain.clear();
+        while (cur >= 0 && !depthDone[cur] && chain.size() <= m)
+        {
+            chain.push_back(cur);
+            cur = tree.parent[cur];
+        }
+        int d = cur >= 0 && depthDone[cur] ? tree.depth[cur] + 1 : 0;
+        for (size_t c = chain.size(); c-- > 0;)
+        {
+            tree.depth[chain[c]] = d++;
+            depthDone[chain[c]] = 1;
+        }
+    }
+    return tree;
+}
@@ -0,0 +1,570 @@
+﻿#include "fast_dxf_reader.h"
+#include "hatch_boundary.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const size_t kParallelMinBytes = 4u << 20; // ENTITIES 段小于 4MB 时串行解析
+
+// ------------------ 内存映射 ------------------
+bool MappedFile::open(const std::string &filename)
+{
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    _file = file;
+    _mapping = mapping;
+    _data = static_cast<const char *>(view);
+    _size = (size_t)size.QuadPart;
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void *view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // 映射建立后即可关闭描述符
+    if (view == MAP_FAILED)
+        return false;
+    madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+    _data = static_cast<const char *>(view);
+    _size = (size_t)st.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (!_data)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(_data);
+    CloseHandle(_mapping);
+    CloseHandle(_file);
+    _mapping = _file = nullptr;
+#else
+    munmap(const_cast<char *>(_data), _size);
+#endif
+    _data = nullptr;
+    _size = 0;
+}
+
+// ------------------ 组码扫描 ------------------
+static std::string_view trimView(std::string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+        s.remove_suffix(1);
+    return s;
+}
+
+bool DxfTokenizer::readLine(std::string_view &line)
+{
+    if (_cur >= _end)
+        return false;
+    const char *nl = static_cast<const char *>(std::memchr(_cur, '\n', _end - _cur));
+    const char *lineEnd = nl ? nl : _end;
+    line = std::string_view(_cur, lineEnd - _cur);
+    _cur = nl ? nl + 1 : _end;
+    // 兼容 CRLF 换行
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    return true;
+}
+
+bool DxfTokenizer::next(DxfGroup &g)
+{
+    std::string_view codeLine;
+    if (!readLine(codeLine))
+        return false;
+    codeLine = trimView(codeLine);
+    const char *last = codeLine.data() + codeLine.size();
+    auto res = std::from_chars(codeLine.data(), last, g.code);
+    if (res.ec != std::errc() || res.ptr != last || !readLine(g.value))
+    {
+        _failed = true;
+        return false;
+    }
+    g.value = trimView(g.value);
+    return true;
+}
+
+double DxfTokenizer::toDouble(const DxfGroup &g)
+{
+    std::string_view s = g.value;
+    if (!s.empty() && s.front() == '+')
+        s.remove_prefix(1);
+    double v = 0.0;
+    auto res = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (res.ec != std::errc())
+        _failed = true;
+    return v;
+}
+
+// ------------------ 图元解码 ------------------
+// 进入时 g 为 "0 LWPOLYLINE"，返回时 g 为下一个图元的 0 组（返回值表示是否还有后续组）
+static bool parseLWPolyline(DxfTokenizer &tok, DxfGroup &g, std::vector<RawPoly> &out, const Region *region)
+{
+    RawPoly p;
+    p.area = 0;
+    bool more;
+    while ((more = tok.next(g)) && g.code != 0)
+    {
+        switch (g.code)
+        {
+        case 90: // 顶点数
+        {
+            size_t n = 0;
+            std::from_chars(g.value.data(), g.value.data() + g.value.size(), n);
+            p.pts.reserve(n);
+            break;
+        }
+        case 10:
+            p.pts.push_back({(float)tok.toDouble(g), 0.0f, 0.0f});
+            break;
+        case 20:
+            if (!p.pts.empty())
+                p.pts.back().y = (float)tok.toDouble(g);
+            break;
+        case 8: // 图层名
+            p.layer.assign(g.value.data(), g.value.size());
+            break;
+        default:
+            break;
+        }
+    }
+    if (!p.pts.empty() && (!region || region->mayIntersect(boundsOfRing(p.pts))))
+    {
+        finalizeRawPoly(p);
+        out.push_back(std::move(p));
+    }
+    return more;
+}
+
+static bool parseCircle(DxfTokenizer &tok, DxfGroup &g, std::vector<RawPoly> &out, const Region *region)
+{
+    double cx = 0, cy = 0, r = 0;
+    std::string layer;
+    bool more;
+    while ((more = tok.next(g)) && g.code != 0)
+    {
+        if (g.code == 8)
+            layer.assign(g.value.data(), g.value.size());
+        else if (g.code == 10)
+            cx = tok.toDouble(g);
+        else if (g.code == 20)
+            cy = tok.toDouble(g);
+        else if (g.code == 40)
+            r = tok.toDouble(g);
+    }
+    Bounds b;
+    b.add(cx - r, cy - r);
+    b.add(cx + r, cy + r);
+    if (region && !region->mayIntersect(b))
+        return more;
+    out.push_back(makeCirclePoly(cx, cy, r));
+    out.back().layer = std::move(layer);
+    return more;
+}
+
+// HATCH 的边界段：91 给出环数，每个环以 92（类型标志）开头。
+// 多段线环（标志位 2）为 72 有无凸度、73 是否闭合、93 顶点数，随后是 10/20[/42]；
+// 边环为 93 边数，每条边以 72（1 直线、2 圆弧、3 椭圆弧、4 样条）开头。
+// 环之后的 75 起是填充样式与图案，98 之后的 10/20 为种子点，都不属于边界
+static bool parseHatch(DxfTokenizer &tok, DxfGroup &g, std::vector<RawPoly> &out, const Region *region)
+{
+    enum Edge
+    {
+        NoEdge,
+        Line,
+        Arc,
+        Ellipse,
+        Spline
+    };
+    struct BulgeVertex
+    {
+        double x, y, bulge;
+    };
+    std::string layer;
+    std::vector<std::vector<Vertex>> loops;
+    std::vector<Vertex> ring, edge;
+    std::vector<BulgeVertex> verts; // 多段线环的顶点，环结束时再按凸度连成段
+    bool inBoundary = false, inLoop = false, polyline = false;
+    Edge kind = NoEdge;
+    double x0 = 0, y0 = 0, x1 = 0, y1 = 0, radius = 0, start = 0, end = 0;
+    bool ccw = true;
+
+    // 当前边离散后接到环尾
+    auto flushEdge = [&]()
+    {
+        if (kind == Line)
+            hatchLineEdge(edge, x0, y0, x1, y1);
+        else if (kind == Arc)
+            hatchArcEdge(edge, x0, y0, radius, start, end, ccw);
+        else if (kind == Ellipse)
+            hatchEllipseEdge(edge, x0, y0, x1, y1, radius, start, end, ccw);
+        appendHatchEdge(ring, edge);
+        kind = NoEdge;
+    };
+    auto endLoop = [&]()
+    {
+        if (polyline)
+        {
+            for (size_t i = 0; i < verts.size(); i++)
+            {
+                const BulgeVertex &a = verts[i], &b = verts[(i + 1) % verts.size()];
+                appendBulgeSegment(ring, a.x, a.y, b.x, b.y, a.bulge);
+            }
+            verts.clear();
+        }
+        else
+            flushEdge();
+        if (!ring.empty())
+            loops.push_back(std::move(ring));
+        ring.clear();
+        inLoop = false;
+    };
+
+    bool more;
+    while ((more = tok.next(g)) && g.code != 0)
+    {
+        if (g.code == 8)
+        {
+            layer.assign(g.value.data(), g.value.size());
+            continue;
+        }
+        if (g.code == 91)
+        {
+            inBoundary = true;
+            continue;
+        }
+        if (!inBoundary)
+            continue;
+        if (g.code == 75 || g.code == 98)
+        {
+            // 边界段结束
+            if (inLoop)
+                endLoop();
+            inBoundary = false;
+            continue;
+        }
+        if (g.code == 92)
+        {
+            if (inLoop)
+                endLoop();
+            int flags = 0;
+            std::from_chars(g.value.data(), g.value.data() + g.value.size(), flags);
+            polyline = (flags & 2) != 0;
+            inLoop = true;
+            continue;
+        }
+        if (!inLoop)
+            continue;
+        if (polyline)
+        {
+            if (g.code == 10)
+                verts.push_back({tok.toDouble(g), 0.0, 0.0});
+            else if (g.code == 20 && !verts.empty())
+                verts.back().y = tok.toDouble(g);
+            else if (g.code == 42 && !verts.empty())
+                verts.back().bulge = tok.toDouble(g);
+            continue;
+        }
+        if (g.code == 72)
+        {
+            flushEdge();
+            int type = 0;
+            std::from_chars(g.value.data(), g.value.data() + g.value.size(), type);
+            kind = type >= Line && type <= Spline ? (Edge)type : NoEdge;
+            ccw = true;
+            continue;
+        }
+        if (kind == Spline || kind == NoEdge)
+            continue; // 样条边的数据不解码，与 libdxfrw 的结果一致
+        switch (g.code)
+        {
+        case 10:
+            x0 = tok.toDouble(g);
+            break;
+        case 20:
+            y0 = tok.toDouble(g);
+            break;
+        case 11:
+            x1 = tok.toDouble(g);
+            break;
+        case 21:
+            y1 = tok.toDouble(g);
+            break;
+        case 40:
+            radius = tok.toDouble(g); // 圆弧半径，椭圆弧时为短长轴之比
+            break;
+        case 50:
+            start = tok.toDouble(g) * M_PI / 180.0;
+            break;
+        case 51:
+            end = tok.toDouble(g) * M_PI / 180.0;
+            break;
+        case 73:
+            ccw = g.value != "0";
+            break;
+        case 97: // 边之后是关联的源对象数
+            flushEdge();
+            break;
+        default:
+            break;
+        }
+    }
+    if (inLoop)
+        endLoop();
+    if (region)
+    {
+        Bounds b;
+        for (const auto &ring : loops)
+            for (const auto &v : ring)
+                b.add(v.x, v.y);
+        if (!region->mayIntersect(b))
+            return more;
+    }
+    appendHatchLoops(loops, layer, out);
+    return more;
+}
+
+// 从 tok 当前位置开始解码图元，遇到 ENDSEC 或数据结束时停止
+static bool parseEntityGroups(DxfTokenizer &tok, std::vector<RawPoly> &out, const Region *region)
+{
+    DxfGroup g;
+    bool more = tok.next(g);
+    while (more)
+    {
+        if (g.code != 0)
+            more = tok.next(g);
+        else if (g.value == "ENDSEC")
+            break;
+        else if (g.value == "LWPOLYLINE")
+            more = parseLWPolyline(tok, g, out, region);
+        else if (g.value == "CIRCLE")
+            more = parseCircle(tok, g, out, region);
+        else if (g.value == "HATCH")
+            more = parseHatch(tok, g, out, region);
+        else
+            more = tok.next(g); // 其它图元 MyDXFReader 也不关心，直接跳过
+    }
+    return !tok.failed();
+}
+
+// ------------------ 并行分块 ------------------
+// 在 [p, end) 中找到下一个图元的起始行（行首位置）。
+// DXF 是“组码行/值行”交替排列的，单独一行 "0" 既可能是组码也可能是值（例如图层名 0），
+// 但值行之后必然是整数组码行，所以 "0" 之后紧跟以字母开头的行时，它一定是图元起始的组码 0。
+static const char *nextEntityBoundary(const char *p, const char *end)
+{
+    // 先对齐到下一行行首
+    if (const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p)))
+        p = nl + 1;
+    else
+        return end;
+
+    DxfGroup g;
+    while (p < end)
+    {
+        // 借用扫描器按“组码+下一行”读取，解析失败说明这一行不是组码，错开一行继续
+        DxfTokenizer probe(p, end);
+        if (probe.next(g) && g.code == 0 && !g.value.empty() && std::isalpha((unsigned char)g.value.front()))
+            return p;
+        const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (!nl)
+            break;
+        p = nl + 1;
+    }
+    return end;
+}
+
+// 找到 ENTITIES 段结束的 "0 / ENDSEC"，返回组码行行首。
+// 组码行只能是整数，所以 ENDSEC 只可能是值行；前一行为 0 时即为段结束标记
+static const char *findSectionEnd(const char *begin, const char *end)
+{
+    std::string_view text(begin, end - begin);
+    size_t pos = 0;
+    while ((pos = text.find("ENDSEC", pos)) != std::string_view::npos)
+    {
+        const char *valueLine = begin + pos;
+        if (valueLine > begin && valueLine[-1] == '\n')
+        {
+            // 回退到前一行
+            const char *codeEnd = valueLine - 1;
+            if (codeEnd > begin && codeEnd[-1] == '\r')
+                codeEnd--;
+            const char *codeBegin = codeEnd;
+            while (codeBegin > begin && codeBegin[-1] != '\n')
+                codeBegin--;
+            if (trimView(std::string_view(codeBegin, codeEnd - codeBegin)) == "0")
+                return codeBegin;
+        }
+        pos += 6;
+    }
+    return end;
+}
+
+// 把 [begin, end) 按图元边界切块，多个线程各自解码到独立缓冲区，最后按原始顺序合并，
+// 保证多边形下标与串行解析完全一致
+static bool parseEntitiesParallel(const char *begin, const char *end, unsigned threads, std::vector<RawPoly> &out,
+                                  const Region *region)
+{
+    const size_t chunkCount = (size_t)threads * 4; // 多切几块，让先完成的线程继续领取
+    const size_t approx = (size_t)(end - begin) / chunkCount;
+    std::vector<const char *> bounds{begin};
+    for (size_t i = 1; i < chunkCount; i++)
+    {
+        const char *b = nextEntityBoundary(std::max(begin + i * approx, bounds.back()), end);
+        if (b >= end)
+            break;
+        if (b > bounds.back())
+            bounds.push_back(b);
+    }
+    bounds.push_back(end);
+
+    const size_t chunks = bounds.size() - 1;
+    std::vector<std::vector<RawPoly>> buffers(chunks);
+    std::vector<char> ok(chunks, 0);
+    std::atomic<size_t> nextChunk{0};
+    auto worker = [&]()
+    {
+        for (size_t c; (c = nextChunk.fetch_add(1)) < chunks;)
+        {
+            TraceScope trace("parse chunk");
+            DxfTokenizer tok(bounds[c], bounds[c + 1]);
+            ok[c] = parseEntityGroups(tok, buffers[c], region);
+            trace.arg("chunk", (int64_t)c).arg("bytes", (int64_t)(bounds[c + 1] - bounds[c])).arg("polygons", (int64_t)buffers[c].size());
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < std::min<size_t>(threads, chunks); t++)
+        pool.emplace_back([&]()
+                          {
+                              Trace::setThreadName("parse worker");
+                              worker(); });
+    worker();
+    for (auto &t : pool)
+        t.join();
+
+    if (std::find(ok.begin(), ok.end(), 0) != ok.end())
+        return false;
+    size_t total = out.size();
+    for (auto &b : buffers)
+        total += b.size();
+    out.reserve(total);
+    for (auto &b : buffers)
+        out.insert(out.end(), std::make_move_iterator(b.begin()), std::make_move_iterator(b.end()));
+    return true;
+}
+
+bool readDxfFast(const std::string &filename, std::vector<RawPoly> &out, unsigned threads, const Region *region)
+{
+    MappedFile file;
+    if (!file.open(filename))
+        return false;
+    return readDxfFastBuffer(file.data(), file.size(), out, threads, region);
+}
+
+bool readDxfFastBuffer(const char *data, size_t size, std::vector<RawPoly> &out, unsigned threads,
+                       const Region *region)
+{
+    TraceScope trace("readDxfFast");
+    // 二进制 DXF 交给 libdxfrw
+    static const char binarySentinel[] = "AutoCAD Binary DXF";
+    if (size >= sizeof(binarySentinel) - 1 &&
+        std::memcmp(data, binarySentinel, sizeof(binarySentinel) - 1) == 0)
+        return false;
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    const char *fileEnd = data + size;
+    DxfTokenizer tok(data, fileEnd);
+    std::vector<RawPoly> polys;
+    std::string_view section;
+    bool sawEntities = false;
+    DxfGroup g;
+    while (tok.next(g))
+    {
+        if (g.code != 0)
+            continue;
+        if (g.value == "SECTION")
+        {
+            if (!tok.next(g) || g.code != 2)
+                return false;
+            section = g.value;
+            if (section == "ENTITIES")
+            {
+                const char *begin = tok.position();
+                const char *end = findSectionEnd(begin, fileEnd);
+                // 小文件分块的收益抵不过线程开销
+                if (threads > 1 && (size_t)(end - begin) >= kParallelMinBytes)
+                {
+                    if (!parseEntitiesParallel(begin, end, threads, polys, region))
+                        return false;
+                    tok = DxfTokenizer(end, fileEnd);
+                }
+                else if (!parseEntityGroups(tok, polys, region))
+                    return false;
+                sawEntities = true;
+                section = {};
+            }
+        }
+        else if (g.value == "ENDSEC")
+            section = {};
+        else if (g.value == "EOF")
+            break;
+        else if (section == "BLOCKS" && (g.value == "LWPOLYLINE" || g.value == "CIRCLE" || g.value == "HATCH"))
+            return false; // 块定义里的图元同样会回调给 MyDXFReader，这里不展开，交给 libdxfrw
+    }
+    if (tok.failed() || !sawEntities)
+        return false;
+
+    if (out.empty())
+        out = std::move(polys);
+    else
+        out.insert(out.end(), std::make_move_iterator(polys.begin()), std::make_move_iterator(polys.end()));
+    return true;
+}
@@ -0,0 +1,155 @@
+﻿#include "hatch_boundary.h"
+#include <algorithm>
+#include "containment.h"
+
+static const int kFullCircleSegments = 64; // 与 makeCirclePoly 的默认密度一致
+
+static double distance2(const Vertex &a, const Vertex &b)
+{
+    const double dx = (double)a.x - b.x, dy = (double)a.y - b.y;
+    return dx * dx + dy * dy;
+}
+
+// 从 a0 出发扫过的角度：逆时针为 (0, 2π]，顺时针为 [-2π, 0)，起止角相同视为整圆
+static double sweepAngle(double a0, double a1, bool ccw)
+{
+    const double full = 2.0 * M_PI;
+    double s = std::fmod(a1 - a0, full);
+    if (ccw && s <= 0)
+        s += full;
+    else if (!ccw && s >= 0)
+        s -= full;
+    return s;
+}
+
+static int segmentsFor(double sweep)
+{
+    return std::max(1, (int)std::ceil(kFullCircleSegments * std::fabs(sweep) / (2.0 * M_PI)));
+}
+
+void appendHatchEdge(std::vector<Vertex> &ring, std::vector<Vertex> &edge)
+{
+    if (edge.empty())
+        return;
+    size_t first = 0;
+    if (!ring.empty())
+    {
+        const Vertex &tail = ring.back();
+        if (distance2(tail, edge.back()) < distance2(tail, edge.front()))
+            std::reverse(edge.begin(), edge.end());
+        if (std::fabs(tail.x - edge.front().x) < 1e-6f && std::fabs(tail.y - edge.front().y) < 1e-6f)
+            first = 1;
+    }
+    ring.insert(ring.end(), edge.begin() + first, edge.end());
+    edge.clear();
+}
+
+void hatchLineEdge(std::vector<Vertex> &edge, double x0, double y0, double x1, double y1)
+{
+    edge.push_back({(float)x0, (float)y0, 0.0f});
+    edge.push_back({(float)x1, (float)y1, 0.0f});
+}
+
+void hatchArcEdge(std::vector<Vertex> &edge, double cx, double cy, double r,
+                  double start, double end, bool ccw)
+{
+    if (!ccw)
+    {
+        start = -start;
+        end = -end;
+    }
+    const double sweep = sweepAngle(start, end, ccw);
+    const int n = segmentsFor(sweep);
+    for (int i = 0; i <= n; i++)
+    {
+        const double a = start + sweep * i / n;
+        edge.push_back({(float)(cx + r * std::cos(a)), (float)(cy + r * std::sin(a)), 0.0f});
+    }
+}
+
+void hatchEllipseEdge(std::vector<Vertex> &edge, double cx, double cy, double mx, double my,
+                      double ratio, double start, double end, bool ccw)
+{
+    if (!ccw)
+    {
+        start = -start;
+        end = -end;
+    }
+    // 角度换算成参数：点 = 圆心 + 长轴 * cos(t) + 短轴 * sin(t)
+    const double t0 = std::atan2(std::sin(start), ratio * std::cos(start));
+    const double t1 = std::atan2(std::sin(end), ratio * std::cos(end));
+    const double sweep = sweepAngle(t0, t1, ccw);
+    const double nx = -my * ratio, ny = mx * ratio; // 短轴
+    const int n = segmentsFor(sweep);
+    for (int i = 0; i <= n; i++)
+    {
+        const double t = t0 + sweep * i / n;
+        const double c = std::cos(t), s = std::sin(t);
+        edge.push_back({(float)(cx + mx * c + nx * s), (float)(cy + my * c + ny * s), 0.0f});
+    }
+}
+
+void appendBulgeSegment(std::vector<Vertex> &ring, double x0, double y0, double x1, double y1, double bulge)
+{
+    ring.push_back({(float)x0, (float)y0, 0.0f});
+    if (std::fabs(bulge) < 1e-9 || (x0 == x1 && y0 == y1))
+        return;
+    // 圆心在弦中点沿左法向偏移 (1 - b²) / (4b) 倍弦长处，圆心角 4·atan(b)，正值为逆时针
+    const double k = (1.0 - bulge * bulge) / (4.0 * bulge);
+    const double cx = (x0 + x1) * 0.5 - (y1 - y0) * k;
+    const double cy = (y0 + y1) * 0.5 + (x1 - x0) * k;
+    const double r = std::hypot(x0 - cx, y0 - cy);
+    const double a0 = std::atan2(y0 - cy, x0 - cx);
+    const double sweep = 4.0 * std::atan(bulge);
+    const int n = segmentsFor(sweep);
+    for (int i = 1; i < n; i++)
+    {
+        const double a = a0 + sweep * i / n;
+        ring.push_back({(float)(cx + r * std::cos(a)), (float)(cy + r * std::sin(a)), 0.0f});
+    }
+}
+
+void appendHatchLoops(std::vector<std::vector<Vertex>> &loops, const std::string &layer,
+                      std::vector<RawPoly> &out)
+{
+    std::vector<RawPoly> rings;
+    rings.reserve(loops.size());
+    for (auto &loop : loops)
+    {
+        RawPoly p;
+        p.pts = std::move(loop);
+        p.layer = layer;
+        finalizeRawPoly(p);
+        if (p.pts.size() >= 3)
+            rings.push_back(std::move(p));
+    }
+    loops.clear();
+    if (rings.empty())
+        return;
+    if (rings.size() == 1)
+    {
+        rings[0].role = RingRole::HatchOuter;
+        out.push_back(std::move(rings[0]));
+        return;
+    }
+
+    // 多个环：DXF 只标记了哪些环是外边界，洞里的岛不在标记里，按本 HATCH 内的嵌套深度区分
+    ContainmentTree tree = buildContainmentTree(rings);
+    const size_t m = rings.size();
+    std::vector<std::vector<size_t>> holesOf(m);
+    for (size_t j = 0; j < m; j++)
+        if (tree.depth[j] % 2 == 1)
+            holesOf[tree.parent[j]].push_back(j);
+    for (size_t k = 0; k < m; k++)
+    {
+        if (tree.depth[k] % 2 == 1)
+            continue;
+        rings[k].role = RingRole::HatchOuter;
+        out.push_back(std::move(rings[k]));
+        for (size_t j : holesOf[k])
+        {
+            rings[j].role = RingRole::HatchHole;
+            out.push_back(std::move(rings[j]));
+        }
+    }
+}
@@ -0,0 +1,168 @@
+﻿#include "io_ring.h"
+
+#ifdef CADPROC_HAVE_LIBURING
+#include <fcntl.h>
+#include <liburing.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    // 一次写请求：缓冲归请求所有，短写时从 done 处继续提交剩余部分
+    struct WriteRequest
+    {
+        int fd;
+        uint64_t offset;
+        std::vector<char> data;
+        size_t done = 0;
+    };
+
+    struct FileState
+    {
+        size_t pending = 0;
+        bool failed = false;
+    };
+} // namespace
+
+struct IoRing::Impl
+{
+    io_uring ring;
+    unsigned entries = 0;
+    unsigned inFlight = 0;
+    std::unordered_map<int, FileState> files;
+
+    bool submit(WriteRequest *req)
+    {
+        io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+        if (!sqe)
+            return false;
+        io_uring_prep_write(sqe, req->fd, req->data.data() + req->done, (unsigned)(req->data.size() - req->done),
+                            req->offset + req->done);
+        io_uring_sqe_set_data(sqe, req);
+        if (io_uring_submit(&ring) < 0)
+            return false;
+        inFlight++;
+        return true;
+    }
+
+    // 等待并处理一个完成事件
+    bool reap()
+    {
+        io_uring_cqe *cqe = nullptr;
+        if (io_uring_wait_cqe(&ring, &cqe) < 0)
+            return false;
+        auto *req = static_cast<WriteRequest *>(io_uring_cqe_get_data(cqe));
+        const int res = cqe->res;
+        io_uring_cqe_seen(&ring, cqe);
+        inFlight--;
+
+        FileState &state = files[req->fd];
+        if (res <= 0)
+            state.failed = true;
+        else
+        {
+            req->done += (size_t)res;
+            if (req->done < req->data.size())
+            {
+                if (submit(req))
+                    return true;
+                state.failed = true;
+            }
+        }
+        state.pending--;
+        delete req;
+        return true;
+    }
+};
+
+IoRing::IoRing(std::unique_ptr<Impl> impl_) : impl(std::move(impl_)) {}
+
+IoRing::~IoRing()
+{
+    while (impl->inFlight > 0 && impl->reap())
+        ;
+    for (auto &f : impl->files)
+        ::close(f.first);
+    io_uring_queue_exit(&impl->ring);
+}
+
+std::unique_ptr<IoRing> IoRing::create(unsigned entries)
+{
+    auto impl = std::make_unique<Impl>();
+    // 内核不支持 io_uring（过旧或被禁用）时初始化失败，由调用方回退
+    if (io_uring_queue_init(entries, &impl->ring, 0) < 0)
+        return nullptr;
+    impl->entries = entries;
+    return std::unique_ptr<IoRing>(new IoRing(std::move(impl)));
+}
+
+int IoRing::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0)
+        impl->files[fd] = FileState{};
+    return fd;
+}
+
+bool IoRing::write(int fd, const char *data, size_t size, uint64_t offset)
+{
+    if (size == 0)
+        return true;
+    while (impl->inFlight >= impl->entries)
+        if (!impl->reap())
+            return false;
+    auto *req = new WriteRequest{fd, offset, std::vector<char>(data, data + size)};
+    impl->files[fd].pending++;
+    if (!impl->submit(req))
+    {
+        impl->files[fd].pending--;
+        delete req;
+        return false;
+    }
+    return true;
+}
+
+bool IoRing::close(int fd)
+{
+    auto it = impl->files.find(fd);
+    if (it == impl->files.end())
+        return false;
+    while (impl->files[fd].pending > 0)
+        if (!impl->reap())
+            return false;
+    const bool ok = !impl->files[fd].failed;
+    impl->files.erase(fd);
+    return ::close(fd) == 0 && ok;
+}
+
+#else
+
+struct IoRing::Impl
+{
+};
+
+IoRing::IoRing(std::unique_ptr<Impl> impl_) : impl(std::move(impl_)) {}
+IoRing::~IoRing() = default;
+
+std::unique_ptr<IoRing> IoRing::create(unsigned)
+{
+    return nullptr;
+}
+
+int IoRing::open(const std::string &)
+{
+    return -1;
+}
+
+bool IoRing::write(int, const char *, size_t, uint64_t)
+{
+    return false;
+}
+
+bool IoRing::close(int)
+{
+    return false;
+}
+
+#endif
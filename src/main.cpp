@@ -1,4 +1,9 @@
-﻿#include "MyDxf_reader.hpp"
+﻿#include "async_writer.h"
+#include "bench.h"
+#include "cadproc.h"
+#include "run_report.h"
+#include "shard_run.h"
+#include "trace.h"
 #include "utils.h"
 
 // ------------------ 键盘交互 ------------------
@@ -7,50 +12,240 @@ float rotY = 0.0f;
 int main(int argc, char **argv)
 {
     std::string filename = "../data/sample.dxf";
-    MyDXFReader reader(100.0, "../obj_res");
-    dxfRW dxf(filename.c_str()); // 创建 DXF 读取对象
+    bool bench = false;
+    bool benchTri = false;
+    bool benchHoles = false;
+    bool benchEar = false;
+    bool benchSmall = false;
+    bool benchPred = false;
+    bool benchContain = false;
+    bool dryRun = false;
+    std::string dwgConvertCmd;
+    ConvertOptions convertOptions; // 读取、三角化（引擎与单个 group 的预算）、合并、拉伸等转换参数
+    convertOptions.log = &std::cout;
+    TriangulationOptions &triOptions = convertOptions.triangulation;
+    OutputOptions outputOptions; // OBJ 输出的压缩格式与等级，默认不压缩
+    bool asyncWrite = true;      // OBJ 由独立的写出线程落盘
+    AsyncWriterOptions writerOptions;
+    std::string tracePath;               // 非空时记录 Chrome trace 时间线并写到该文件
+    ShardRunOptions shardRun;            // --shards N 时作为协调进程启动 worker
+    std::vector<std::string> workerArgs; // 原样转发给 worker 的参数（不含输入文件与分片参数）
+    for (int i = 1; i < argc; i++)
+    {
+        const int first = i;
+        bool forward = true;
+        std::string arg = argv[i];
+        if (arg == "--fast")
+            convertOptions.useFastReader = true; // 内存映射快速路径，不支持的内容自动回退到 libdxfrw
+        else if (arg == "--bench-parse")
+            bench = true;
+        else if (arg == "--bench-dwg" && i + 1 < argc)
+            dwgConvertCmd = argv[++i];
+        else if (arg == "--tri-budget-ms" && i + 1 < argc)
+            triOptions.budget.maxMillis = std::stod(argv[++i]);
+        else if (arg == "--tri-budget-iters" && i + 1 < argc)
+            triOptions.budget.maxIterations = (size_t)std::stoull(argv[++i]);
+        else if (arg == "--tri-engine" && i + 1 < argc)
+        {
+            std::string engine = argv[++i];
+            triOptions.engine = engine == "earcut" ? TriEngine::Earcut : engine == "monotone" ? TriEngine::Monotone
+                                                                                              : TriEngine::Auto;
+        }
+        else if (arg == "--tri-hash-threshold" && i + 1 < argc)
+            triOptions.earcutHashThreshold = (size_t)std::stoull(argv[++i]);
+        else if (arg == "--bench-tri")
+            benchTri = true;
+        else if (arg == "--bench-holes")
+            benchHoles = true;
+        else if (arg == "--bench-ear")
+            benchEar = true;
+        else if (arg == "--bench-small")
+            benchSmall = true;
+        else if (arg == "--bench-predicates")
+            benchPred = true;
+        else if (arg == "--bench-containment")
+            benchContain = true;
+        else if (arg == "--compress" && i + 1 < argc)
+        {
+            std::string codec = argv[++i];
+            outputOptions.compression = codec == "gzip" ? OutputCompression::Gzip : codec == "zstd" ? OutputCompression::Zstd
+                                                                                                 : OutputCompression::None;
+        }
+        else if (arg == "--compress-level" && i + 1 < argc)
+            outputOptions.level = std::stoi(argv[++i]);
+        else if (arg == "--optimize-mesh")
+            outputOptions.optimizeMesh = true;
+        else if (arg == "--sync-write")
+            asyncWrite = false;
+        else if (arg == "--writer-queue-mb" && i + 1 < argc)
+            writerOptions.maxBytesInFlight = (size_t)std::stoull(argv[++i]) << 20;
+        else if (arg == "--cull-shared-walls")
+            convertOptions.cullSharedWalls = true; // 剔除相邻外轮廓之间看不见的共用墙面
+        else if (arg == "--wall-tolerance" && i + 1 < argc)
+            convertOptions.wallTolerance = std::stod(argv[++i]);
+        else if (arg == "--union")
+            convertOptions.unionMode = UnionMode::Global; // 分组前合并重叠的外轮廓
+        else if (arg == "--union-per-layer")
+            convertOptions.unionMode = UnionMode::PerLayer;
+        else if ((arg == "--roi" || arg == "--roi-poly") && i + 1 < argc)
+        {
+            // 只转换与该区域相交的图元
+            const std::string text = argv[++i];
+            if (!(arg == "--roi" ? Region::parseBox(text, convertOptions.region)
+                                 : Region::parsePolygon(text, convertOptions.region)))
+            {
+                std::cerr << "Invalid region: " << text << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "--roi-clip")
+            convertOptions.clipToRegion = true;
+        else if (arg == "--hilbert-order")
+            convertOptions.hilbertOrder = true;
+        else if (arg == "--trace" && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (arg == "--dry-run")
+            dryRun = true;
+        else if (arg == "--threads" && i + 1 < argc)
+            convertOptions.threads = (unsigned)std::stoul(argv[++i]); // 0 表示使用全部硬件线程
+        else if (arg == "--shards" && i + 1 < argc)
+            shardRun.shards = (unsigned)std::stoul(argv[++i]), forward = false;
+        else if (arg == "--shard-launch" && i + 1 < argc)
+            shardRun.launch = argv[++i], forward = false;
+        else if (arg == "--shard-dir" && i + 1 < argc)
+            shardRun.workDir = argv[++i], forward = false;
+        else if (arg == "--keep-shards")
+            shardRun.keepShardDirs = true, forward = false;
+        else if (arg == "--shard" && i + 1 < argc)
+        {
+            // 由协调进程传入，见 runShardCoordinator
+            const std::string text = argv[++i];
+            if (!parseShardSpec(text, convertOptions.shard))
+            {
+                std::cerr << "Invalid shard: " << text << "\n";
+                return 1;
+            }
+            forward = false;
+        }
+        else
+            filename = arg, forward = false;
+        if (forward)
+            workerArgs.insert(workerArgs.end(), argv + first, argv + i + 1);
+    }
+    if (!dwgConvertCmd.empty())
+        return benchDwg(filename, dwgConvertCmd);
+    if (bench)
+        return benchParse(filename, convertOptions.threads);
+    if (benchTri)
+        return benchTriangulation();
+    if (benchHoles)
+        return benchHoleBridging();
+    if (benchEar)
+        return benchEarTest();
+    if (benchSmall)
+        return benchSmallPolygons();
+    if (benchPred)
+        return benchPredicates();
+    if (benchContain)
+        return benchContainment();
 
-    std::cout << "Reading file: " << filename << std::endl;
+    if (dryRun)
+    {
+        // 只读取与分组，估算三角形数、内存与各输出格式的字节数
+        std::cout << "Reading file: " << filename << std::endl;
+        CapacityEstimate estimate;
+        if (estimateCadFile(filename, convertOptions, outputOptions, estimate) != ConvertStatus::Ok)
+        {
+            std::cerr << "Failed to read file.\n";
+            return 1;
+        }
+        // 异步写出时队列中最多积压 maxBytesInFlight 字节的网格
+        if (asyncWrite)
+            estimate.writerBytes = std::min<uint64_t>(writerOptions.maxBytesInFlight, estimate.soupVertices() * sizeof(Vertex));
+        estimate.print(std::cout);
+        return 0;
+    }
 
-    if (!dxf.read(&reader, false))
-    { // false 表示不保留块引用
-        std::cerr << "Failed to read file.\n";
-        return 1;
+    if (shardRun.shards > 0)
+        return runShardCoordinator(argv[0], filename, workerArgs, convertOptions, shardRun);
+
+    if (!outputCompressionAvailable(outputOptions.compression))
+    {
+        std::cerr << "Requested compression is not available in this build, writing uncompressed OBJ.\n";
+        outputOptions.compression = OutputCompression::None;
+    }
+
+    if (!tracePath.empty())
+    {
+        Trace::enable(); // 必须在启动解析线程、写出线程之前
+        Trace::setThreadName("main");
     }
-    std::cout << "Parsed polygons: " << reader.polys.size() << "\n";
-
-    auto groups = reader.groupOuterWithHoles();
-    std::cout << "Groups (outer with holes): " << groups.size() << "\n";
-
-    // For each group, build polygonRings (outer then holes), extrude and triangulate (earcut)
-    const float height = reader.defaultHeight;
-    std::vector<Vertex> allTris; // all triangles for export / rendering
-    size_t groupIdx = 0;
-    for (auto &g : groups)
-    {
-        std::vector<std::vector<Vertex>> rings;
-        
-        // 先添加外环，如果有对应的内环再添加内环
-        rings.push_back(g.first.pts);
-        for (auto &hole : g.second)
-            rings.push_back(hole.pts);
-
-        // 利用earcut生成上下面的三角网格
-        auto tris = triangulateRingsToTris(rings, height, 0.0f);
-        // appendVerts(allTris, tris);
-        // 生成侧面三角形
-        for (auto &ring : rings)
+
+    std::cout << "Reading file: " << filename << std::endl;
+
+    RunReport report;
+    std::unique_ptr<AsyncObjWriter> writer;
+    if (asyncWrite)
+        writer = std::make_unique<AsyncObjWriter>(outputOptions, &report.output, writerOptions);
+    // 每个做好的 group 直接交给写出线程，或在当前线程写成 OBJ
+    ShardManifest manifest; // 作为分片 worker 时记录输出的每个 group，供协调进程合并
+    manifest.spec = convertOptions.shard.active() ? formatShardSpec(convertOptions.shard) : "";
+    ConvertCallbacks callbacks;
+    callbacks.onGroup = [&](GroupMesh &&mesh)
+    {
+        if (convertOptions.shard.active())
         {
-            auto side = generateSideTriangles(ring, height);
-            // appendVerts(allTris, side);
-            appendVerts(tris, side);
+            ShardManifestEntry entry;
+            entry.shard = convertOptions.shard.index;
+            entry.index = mesh.index;
+            entry.file = groupObjFileName(mesh.index, outputOptions.compression);
+            entry.triangles = mesh.triangles.size() / 3;
+            for (const auto &v : mesh.triangles)
+                entry.bounds.add(v.x, v.y);
+            entry.layer = mesh.layer;
+            manifest.entries.push_back(std::move(entry));
         }
-
-        // 导出OBJ
-        exportGroupToOBJ(tris, groupIdx++);
+        if (writer)
+        {
+            // 写出队列满时 submit 会等待，时间线上表现为较长的 submit
+            TraceScope trace("submit");
+            trace.arg("group", (int64_t)mesh.index);
+            writer->submit(mesh.index, std::move(mesh.triangles));
+        }
+        else if (exportGroupToOBJ(mesh.triangles, mesh.index, outputOptions, &report.output))
+            std::cout << "Exported " << groupObjFileName(mesh.index, outputOptions.compression) << " ("
+                      << mesh.triangles.size() / 3 << " triangles)\n";
+    };
+    const ConvertStatus status = convertCadFile(filename, convertOptions, callbacks, &report);
+    if (writer)
+    {
+        writer->finish();
+        report.writer = writer->usingIoUring() ? "async (io_uring)" : "async (blocking)";
+        report.writerStalls = writer->stalls();
+    }
+    if (status == ConvertStatus::ReadFailed)
+    {
+        std::cerr << (detectCadFileKind(filename) == CadFileKind::Dwg ? "Failed to read DWG file.\n" : "Failed to read file.\n");
+        return 1;
     }
 
     std::cout << "DXF parsing finished.\n";
+    report.print(std::cout);
+    if (convertOptions.shard.active() && !writeShardManifest("manifest.tsv", manifest))
+    {
+        std::cerr << "Failed to write manifest.tsv.\n";
+        return 1;
+    }
+
+    if (!tracePath.empty())
+    {
+        // 写出线程已在 finish 中结束，各线程的缓冲区此时都不再变化
+        const long events = Trace::write(tracePath);
+        if (events < 0)
+            std::cerr << "Failed to write trace to " << tracePath << ".\n";
+        else
+            std::cout << "Trace written: " << tracePath << " (" << events << " events)\n";
+    }
 
     return 0;
 }
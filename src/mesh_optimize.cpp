@@ -0,0 +1,235 @@
+﻿#include "mesh_optimize.h"
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    // Forsyth 评分所用的 LRU 缓存大小与参数（"Linear-Speed Vertex Cache Optimisation"）
+    const int kForsythCacheSize = 32;
+    const float kLastTriScore = 0.75f;
+    const float kCacheDecayPower = 1.5f;
+    const float kValenceBoostScale = 2.0f;
+    const float kValenceBoostPower = 0.5f;
+    // 挑选下一个三角形时每个缓存顶点最多检查的相邻三角形数，正常网格的顶点度数远小于它
+    const uint32_t kMaxCandidates = 16;
+
+    float vertexScore(int cachePos, uint32_t remaining)
+    {
+        if (remaining == 0)
+            return -1.0f; // 没有待输出的三角形，分数不再有意义
+        float score = 0.0f;
+        if (cachePos >= 0)
+        {
+            // 刚用过的三个顶点分数固定，避免总是沿着同一条带走下去
+            if (cachePos < 3)
+                score = kLastTriScore;
+            else
+                score = std::pow(1.0f - (float)(cachePos - 3) / (kForsythCacheSize - 3), kCacheDecayPower);
+        }
+        // 剩余三角形越少越优先，尽快把顶点“用完”
+        return score + kValenceBoostScale * std::pow((float)remaining, -kValenceBoostPower);
+    }
+
+    struct VertexKey
+    {
+        uint32_t x, y, z;
+        bool operator==(const VertexKey &o) const { return x == o.x && y == o.y && z == o.z; }
+    };
+
+    struct VertexKeyHash
+    {
+        size_t operator()(const VertexKey &k) const
+        {
+            uint64_t h = (uint64_t)k.x * 0x9e3779b97f4a7c15ull;
+            h ^= ((uint64_t)k.y + 0x632be59bd9b4e019ull) * 0xbf58476d1ce4e5b9ull;
+            h ^= ((uint64_t)k.z + 0x94d049bb133111ebull) * 0x94d049bb133111ebull;
+            return (size_t)(h ^ (h >> 31));
+        }
+    };
+
+    uint32_t floatBits(float f)
+    {
+        if (f == 0.0f)
+            f = 0.0f; // -0 与 +0 视为同一坐标
+        uint32_t u;
+        std::memcpy(&u, &f, sizeof(u));
+        return u;
+    }
+} // namespace
+
+IndexedMesh buildIndexedMesh(const std::vector<Vertex> &triangles)
+{
+    IndexedMesh mesh;
+    const size_t n = triangles.size() - triangles.size() % 3;
+    mesh.indices.reserve(n);
+    std::unordered_map<VertexKey, uint32_t, VertexKeyHash> lookup;
+    lookup.reserve(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        const Vertex &v = triangles[i];
+        VertexKey key{floatBits(v.x), floatBits(v.y), floatBits(v.z)};
+        auto it = lookup.emplace(key, (uint32_t)mesh.vertices.size());
+        if (it.second)
+            mesh.vertices.push_back(v);
+        mesh.indices.push_back(it.first->second);
+    }
+    return mesh;
+}
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount)
+{
+    const size_t triCount = indices.size() / 3;
+    if (triCount < 2)
+        return;
+    const size_t cornerCount = triCount * 3;
+
+    // 顶点 -> 尚未输出的角（三角形下标 * 3 + 角号），按 CSR 存放：
+    // 顶点 v 的角位于 corners[offset[v], offset[v] + remaining[v])，slot[c] 记录角 c 所在位置，移除是 O(1) 的
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (size_t c = 0; c < cornerCount; c++)
+        remaining[indices[c]]++;
+    std::vector<uint32_t> offset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offset[v + 1] = offset[v] + remaining[v];
+    std::vector<uint32_t> corners(cornerCount), slot(cornerCount);
+    {
+        std::vector<uint32_t> fill(offset.begin(), offset.end() - 1);
+        for (size_t c = 0; c < cornerCount; c++)
+        {
+            slot[c] = fill[indices[c]]++;
+            corners[slot[c]] = (uint32_t)c;
+        }
+    }
+
+    // 三角形分数即三个顶点分数之和，用到时现算，顶点分数变化时不必逐个更新相邻三角形；
+    // 重复叠放的图形会让个别顶点挂上成千上万个三角形，逐个更新会退化成平方复杂度
+    std::vector<int> cachePos(vertexCount, -1);
+    std::vector<float> vScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vScore[v] = vertexScore(-1, remaining[v]);
+    auto triScore = [&](size_t t)
+    { return vScore[indices[t * 3]] + vScore[indices[t * 3 + 1]] + vScore[indices[t * 3 + 2]]; };
+    std::vector<char> emitted(triCount, 0);
+
+    std::vector<uint32_t> out;
+    out.reserve(cornerCount);
+    // 每次输出三角形后缓存最多临时多出 3 个顶点，挤出去的顶点随即离开缓存
+    uint32_t cache[kForsythCacheSize + 3];
+    uint32_t nextCache[kForsythCacheSize + 3];
+    int cacheCount = 0;
+
+    size_t best = 0;
+    float bestScore = triScore(0);
+    for (size_t t = 1; t < triCount; t++)
+    {
+        const float score = triScore(t);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = t;
+        }
+    }
+    size_t cursor = 0; // 缓存中没有候选时，从这里顺序找下一个未输出的三角形
+
+    while (best < triCount)
+    {
+        emitted[best] = 1;
+        const uint32_t *tri = &indices[best * 3];
+        int nextCount = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            const uint32_t v = tri[k];
+            out.push_back(v);
+            // 把该角与顶点 v 的最后一个待输出角交换后丢弃
+            const uint32_t c = (uint32_t)(best * 3 + k);
+            const uint32_t last = offset[v] + --remaining[v];
+            corners[slot[c]] = corners[last];
+            slot[corners[last]] = slot[c];
+            bool seen = false;
+            for (int j = 0; j < nextCount; j++)
+                seen = seen || nextCache[j] == v;
+            if (!seen)
+                nextCache[nextCount++] = v;
+        }
+        for (int i = 0; i < cacheCount; i++)
+        {
+            const uint32_t v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                nextCache[nextCount++] = v;
+        }
+
+        for (int i = 0; i < nextCount; i++)
+        {
+            const uint32_t v = nextCache[i];
+            cachePos[v] = i < kForsythCacheSize ? i : -1;
+            vScore[v] = vertexScore(cachePos[v], remaining[v]);
+        }
+        cacheCount = nextCount < kForsythCacheSize ? nextCount : kForsythCacheSize;
+        std::memcpy(cache, nextCache, cacheCount * sizeof(uint32_t));
+
+        // 只在缓存中顶点的相邻三角形里挑下一个，每个顶点最多看 kMaxCandidates 个
+        best = triCount;
+        bestScore = -1e30f;
+        for (int i = 0; i < cacheCount; i++)
+        {
+            const uint32_t v = cache[i];
+            const uint32_t n = remaining[v] < kMaxCandidates ? remaining[v] : kMaxCandidates;
+            for (uint32_t a = offset[v], e = offset[v] + n; a < e; a++)
+            {
+                const size_t t = corners[a] / 3;
+                const float score = triScore(t);
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+        if (best == triCount)
+        {
+            while (cursor < triCount && emitted[cursor])
+                cursor++;
+            best = cursor;
+        }
+    }
+
+    std::memcpy(indices.data(), out.data(), out.size() * sizeof(uint32_t));
+}
+
+void optimizeVertexFetch(IndexedMesh &mesh)
+{
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(mesh.vertices.size(), unused);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+    for (auto &idx : mesh.indices)
+    {
+        if (remap[idx] == unused)
+        {
+            remap[idx] = (uint32_t)vertices.size();
+            vertices.push_back(mesh.vertices[idx]);
+        }
+        idx = remap[idx];
+    }
+    mesh.vertices.swap(vertices);
+}
+
+size_t simulateVertexCacheMisses(const std::vector<uint32_t> &indices, size_t vertexCount, unsigned cacheSize)
+{
+    // FIFO：顶点进入缓存的时间戳与当前时间之差超过缓存大小即已被挤出
+    std::vector<size_t> stamp(vertexCount, 0);
+    size_t time = (size_t)cacheSize + 1;
+    size_t misses = 0;
+    const size_t n = indices.size() - indices.size() % 3;
+    for (size_t i = 0; i < n; i++)
+    {
+        const uint32_t v = indices[i];
+        if (time - stamp[v] > cacheSize)
+        {
+            stamp[v] = time++;
+            misses++;
+        }
+    }
+    return misses;
+}
@@ -0,0 +1,463 @@
+﻿#include "monotone.h"
+#include "predicates.h"
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+namespace
+{
+    struct MPoint
+    {
+        double x, y;
+    };
+
+    // 扫描顺序：y 大者在上，y 相同时 x 小者在上
+    inline bool below(const MPoint &p, const MPoint &q)
+    {
+        return p.y < q.y || (p.y == q.y && p.x > q.x);
+    }
+
+    // 符号精确：共线与近共线的顶点不会被误判成凸/凹
+    inline double orient(const MPoint &a, const MPoint &b, const MPoint &c)
+    {
+        return orient2d(a.x, a.y, b.x, b.y, c.x, c.y);
+    }
+
+    enum VertexType
+    {
+        StartVertex,
+        EndVertex,
+        SplitVertex,
+        MergeVertex,
+        RegularVertex
+    };
+
+    class MonotoneTriangulator
+    {
+    public:
+        bool run(const RingList &rings, std::vector<uint32_t> &indices);
+
+    private:
+        // 状态结构中的边 e 指 e -> next[e]，按当前扫描线处的 x 排序
+        struct EdgeOrder
+        {
+            using is_transparent = void;
+            const MonotoneTriangulator *owner;
+
+            bool operator()(int a, int b) const
+            {
+                double xa = owner->xAt(a), xb = owner->xAt(b);
+                if (xa != xb)
+                    return xa < xb;
+                double sa = owner->downwardSlope(a), sb = owner->downwardSlope(b);
+                if (sa != sb)
+                    return sa < sb;
+                return a < b;
+            }
+            bool operator()(int a, double x) const { return owner->xAt(a) < x; }
+            bool operator()(double x, int b) const { return x < owner->xAt(b); }
+        };
+
+        bool buildRings(const RingList &rings);
+        bool makeMonotone();
+        bool triangulateFaces(std::vector<uint32_t> &indices);
+        bool triangulateMonotone(const std::vector<int> &face, std::vector<uint32_t> &indices);
+
+        double xAt(int e) const;
+        double downwardSlope(int e) const;
+        int edgeLeftOf(int v) const;
+        void addDiagonal(int a, int b) { diagonals.push_back({a, b}); }
+        void emit(int a, int b, int c, std::vector<uint32_t> &indices);
+
+        std::vector<MPoint> pts;
+        std::vector<uint32_t> origIdx; // 去重后的顶点对应的原始下标
+        std::vector<int> next, prev;
+        std::vector<VertexType> type;
+        std::vector<std::pair<int, int>> diagonals;
+        size_t holesKept = 0;
+        double expectedArea = 0;
+        double sweepY = 0;
+        std::set<int, EdgeOrder> status{EdgeOrder{this}};
+    };
+
+    double MonotoneTriangulator::xAt(int e) const
+    {
+        const MPoint &a = pts[e], &b = pts[next[e]];
+        if (a.y == b.y)
+            return std::min(a.x, b.x);
+        double t = (sweepY - a.y) / (b.y - a.y);
+        t = std::max(0.0, std::min(1.0, t));
+        return a.x + t * (b.x - a.x);
+    }
+
+    // 沿边向下走时 x 的变化率，用于扫描线上 x 相同的两条边排序
+    double MonotoneTriangulator::downwardSlope(int e) const
+    {
+        const MPoint &a = pts[e], &b = pts[next[e]];
+        const MPoint &up = below(a, b) ? b : a;
+        const MPoint &down = below(a, b) ? a : b;
+        double dy = up.y - down.y;
+        return dy > 0 ? (down.x - up.x) / dy : 0.0;
+    }
+
+    // 状态结构中位于 v 正左侧的边
+    int MonotoneTriangulator::edgeLeftOf(int v) const
+    {
+        auto it = status.upper_bound(pts[v].x);
+        if (it == status.begin())
+            return -1;
+        return *--it;
+    }
+
+    // 去掉重复点，统一为“内部在左侧”的走向（外环逆时针、洞顺时针），并旋转一个小角度避免水平边
+    bool MonotoneTriangulator::buildRings(const RingList &rings)
+    {
+        const double s = 0.0137, c = std::sqrt(1.0 - s * s);
+        uint32_t offset = 0;
+        for (size_t k = 0; k < rings.size(); k++)
+        {
+            const auto &ring = rings[k];
+            std::vector<int> ids;
+            ids.reserve(ring.size());
+            for (size_t i = 0; i < ring.size(); i++)
+            {
+                MPoint p{ring[i].x * c - ring[i].y * s, ring[i].x * s + ring[i].y * c};
+                if (!ids.empty() && pts[ids.back()].x == p.x && pts[ids.back()].y == p.y)
+                    continue;
+                ids.push_back((int)pts.size());
+                pts.push_back(p);
+                origIdx.push_back(offset + (uint32_t)i);
+            }
+            offset += (uint32_t)ring.size();
+            if (ids.size() > 1 && pts[ids.front()].x == pts[ids.back()].x && pts[ids.front()].y == pts[ids.back()].y)
+            {
+                pts.pop_back();
+                origIdx.pop_back();
+                ids.pop_back();
+            }
+            if (ids.size() < 3)
+            {
+                if (k == 0)
+                    return false;
+                pts.resize(pts.size() - ids.size());
+                origIdx.resize(pts.size());
+                continue; // 退化的洞直接忽略
+            }
+
+            double area = 0;
+            for (size_t i = 0, j = ids.size() - 1; i < ids.size(); j = i++)
+                area += pts[ids[j]].x * pts[ids[i]].y - pts[ids[i]].x * pts[ids[j]].y;
+            if (area == 0)
+                return false;
+            if ((k == 0) != (area > 0))
+                std::reverse(ids.begin(), ids.end());
+            expectedArea += k == 0 ? std::abs(area) * 0.5 : -std::abs(area) * 0.5;
+            if (k > 0)
+                holesKept++;
+
+            next.resize(pts.size());
+            prev.resize(pts.size());
+            for (size_t i = 0; i < ids.size(); i++)
+            {
+                next[ids[i]] = ids[(i + 1) % ids.size()];
+                prev[ids[i]] = ids[(i + ids.size() - 1) % ids.size()];
+            }
+        }
+        return true;
+    }
+
+    // 自上而下扫描，在 split/merge 顶点处加入对角线，把多边形剖分成 y 单调的子多边形
+    bool MonotoneTriangulator::makeMonotone()
+    {
+        const int n = (int)pts.size();
+        type.resize(n);
+        for (int v = 0; v < n; v++)
+        {
+            const MPoint &p = pts[prev[v]], &c = pts[v], &q = pts[next[v]];
+            bool prevBelow = below(p, c), nextBelow = below(q, c);
+            bool convex = orient(p, c, q) > 0;
+            if (prevBelow && nextBelow)
+                type[v] = convex ? StartVertex : SplitVertex;
+            else if (!prevBelow && !nextBelow)
+                type[v] = convex ? EndVertex : MergeVertex;
+            else
+                type[v] = RegularVertex;
+        }
+
+        std::vector<int> order(n);
+        for (int i = 0; i < n; i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](int a, int b)
+                  { return below(pts[b], pts[a]); });
+
+        std::vector<int> helper(n, -1);
+        std::vector<std::set<int, EdgeOrder>::iterator> handle(n);
+        std::vector<char> inStatus(n, 0);
+        auto insertEdge = [&](int e)
+        {
+            handle[e] = status.insert(e).first;
+            inStatus[e] = 1;
+            helper[e] = e;
+        };
+        auto eraseEdge = [&](int e)
+        {
+            if (!inStatus[e])
+                return false;
+            status.erase(handle[e]);
+            inStatus[e] = 0;
+            return true;
+        };
+        auto fixUp = [&](int v, int e)
+        {
+            if (helper[e] >= 0 && type[helper[e]] == MergeVertex)
+                addDiagonal(v, helper[e]);
+        };
+
+        for (int v : order)
+        {
+            sweepY = pts[v].y;
+            switch (type[v])
+            {
+            case StartVertex:
+                insertEdge(v);
+                break;
+            case EndVertex:
+                fixUp(v, prev[v]);
+                if (!eraseEdge(prev[v]))
+                    return false;
+                break;
+            case SplitVertex:
+            {
+                int ej = edgeLeftOf(v);
+                if (ej < 0)
+                    return false;
+                addDiagonal(v, helper[ej]);
+                helper[ej] = v;
+                insertEdge(v);
+                break;
+            }
+            case MergeVertex:
+            {
+                fixUp(v, prev[v]);
+                if (!eraseEdge(prev[v]))
+                    return false;
+                int ej = edgeLeftOf(v);
+                if (ej < 0)
+                    return false;
+                fixUp(v, ej);
+                helper[ej] = v;
+                break;
+            }
+            case RegularVertex:
+                if (below(pts[next[v]], pts[v]))
+                {
+                    // 边界向下走，内部在 v 右侧
+                    fixUp(v, prev[v]);
+                    if (!eraseEdge(prev[v]))
+                        return false;
+                    insertEdge(v);
+                }
+                else
+                {
+                    int ej = edgeLeftOf(v);
+                    if (ej < 0)
+                        return false;
+                    fixUp(v, ej);
+                    helper[ej] = v;
+                }
+                break;
+            }
+        }
+        return status.empty();
+    }
+
+    // 把环边与对角线组成平面图，沿“左侧为面”的方向追踪出每个单调子多边形并三角化
+    bool MonotoneTriangulator::triangulateFaces(std::vector<uint32_t> &indices)
+    {
+        const int n = (int)pts.size();
+        // 半边：2v 为环边 v->next[v]（内部在左），2v+1 为其反向（外部）；之后是对角线的两个方向
+        const size_t heCount = 2 * (size_t)n + 2 * diagonals.size();
+        std::vector<int> heFrom(heCount), heTo(heCount);
+        for (int v = 0; v < n; v++)
+        {
+            heFrom[2 * v] = v, heTo[2 * v] = next[v];
+            heFrom[2 * v + 1] = next[v], heTo[2 * v + 1] = v;
+        }
+        for (size_t d = 0; d < diagonals.size(); d++)
+        {
+            size_t h = 2 * (size_t)n + 2 * d;
+            heFrom[h] = diagonals[d].first, heTo[h] = diagonals[d].second;
+            heFrom[h + 1] = diagonals[d].second, heTo[h + 1] = diagonals[d].first;
+        }
+
+        // 每个顶点的出边按极角排序（CSR 存储）
+        std::vector<size_t> start(n + 1, 0);
+        for (size_t h = 0; h < heCount; h++)
+            start[heFrom[h] + 1]++;
+        for (int v = 0; v < n; v++)
+            start[v + 1] += start[v];
+        std::vector<int> out(heCount);
+        std::vector<size_t> fill(start.begin(), start.end() - 1);
+        for (size_t h = 0; h < heCount; h++)
+            out[fill[heFrom[h]]++] = (int)h;
+        std::vector<double> angle(heCount);
+        for (size_t h = 0; h < heCount; h++)
+            angle[h] = std::atan2(pts[heTo[h]].y - pts[heFrom[h]].y, pts[heTo[h]].x - pts[heFrom[h]].x);
+        std::vector<size_t> pos(heCount);
+        for (int v = 0; v < n; v++)
+        {
+            std::sort(out.begin() + start[v], out.begin() + start[v + 1], [&](int a, int b)
+                      { return angle[a] < angle[b]; });
+            for (size_t k = start[v]; k < start[v + 1]; k++)
+                pos[out[k]] = k - start[v];
+        }
+        auto twin = [](size_t h)
+        { return h ^ 1; };
+        // 面在左侧时，下一条半边是终点处紧邻反向半边的顺时针方向那条
+        auto nextHe = [&](size_t h)
+        {
+            int v = heTo[h];
+            size_t deg = start[v + 1] - start[v];
+            size_t p = pos[twin(h)];
+            return (size_t)out[start[v] + (p + deg - 1) % deg];
+        };
+
+        std::vector<char> visited(heCount, 0);
+        std::vector<int> face;
+        for (size_t h0 = 0; h0 < heCount; h0++)
+        {
+            bool interior = h0 >= 2 * (size_t)n || (h0 % 2) == 0;
+            if (!interior || visited[h0])
+                continue;
+            face.clear();
+            size_t h = h0;
+            do
+            {
+                bool inner = h >= 2 * (size_t)n || (h % 2) == 0;
+                if (!inner || visited[h] || face.size() > (size_t)n)
+                    return false;
+                visited[h] = 1;
+                face.push_back(heFrom[h]);
+                h = nextHe(h);
+            } while (h != h0);
+            if (!triangulateMonotone(face, indices))
+                return false;
+        }
+        return true;
+    }
+
+    void MonotoneTriangulator::emit(int a, int b, int c, std::vector<uint32_t> &indices)
+    {
+        if (orient(pts[a], pts[b], pts[c]) < 0)
+            std::swap(b, c);
+        indices.push_back(origIdx[a]);
+        indices.push_back(origIdx[b]);
+        indices.push_back(origIdx[c]);
+    }
+
+    // 单调多边形的栈式三角化，face 为逆时针顶点序列
+    bool MonotoneTriangulator::triangulateMonotone(const std::vector<int> &face, std::vector<uint32_t> &indices)
+    {
+        const size_t m = face.size();
+        if (m < 3)
+            return false;
+        if (m == 3)
+        {
+            emit(face[0], face[1], face[2], indices);
+            return true;
+        }
+        size_t top = 0, bottom = 0;
+        for (size_t i = 1; i < m; i++)
+        {
+            if (below(pts[face[top]], pts[face[i]]))
+                top = i;
+            if (below(pts[face[i]], pts[face[bottom]]))
+                bottom = i;
+        }
+
+        // 逆时针从最高点往后走是左链，往前走是右链，两条链各自必须自上而下单调
+        std::vector<std::pair<int, bool>> left, right; // (顶点, 是否左链)
+        for (size_t i = (top + 1) % m; i != bottom; i = (i + 1) % m)
+            left.push_back({face[i], true});
+        for (size_t i = (top + m - 1) % m; i != bottom; i = (i + m - 1) % m)
+            right.push_back({face[i], false});
+        auto descending = [&](const std::vector<std::pair<int, bool>> &chain)
+        {
+            for (size_t i = 1; i < chain.size(); i++)
+                if (!below(pts[chain[i].first], pts[chain[i - 1].first]))
+                    return false;
+            return true;
+        };
+        if (!descending(left) || !descending(right))
+            return false;
+
+        std::vector<std::pair<int, bool>> u;
+        u.reserve(m);
+        u.push_back({face[top], true});
+        std::merge(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(u),
+                   [&](const std::pair<int, bool> &a, const std::pair<int, bool> &b)
+                   { return below(pts[b.first], pts[a.first]); });
+        u.push_back({face[bottom], true});
+
+        std::vector<std::pair<int, bool>> stack{u[0], u[1]};
+        for (size_t j = 2; j + 1 < m; j++)
+        {
+            if (u[j].second != stack.back().second)
+            {
+                // 不同链：与栈中所有顶点连成三角形
+                for (size_t i = 0; i + 1 < stack.size(); i++)
+                    emit(u[j].first, stack[i].first, stack[i + 1].first, indices);
+                auto last = stack.back();
+                stack.assign({last, u[j]});
+            }
+            else
+            {
+                // 同一条链：只要对角线在内部就持续切掉三角形
+                auto last = stack.back();
+                stack.pop_back();
+                while (!stack.empty())
+                {
+                    double o = orient(pts[stack.back().first], pts[last.first], pts[u[j].first]);
+                    if (u[j].second ? o <= 0 : o >= 0)
+                        break;
+                    emit(stack.back().first, last.first, u[j].first, indices);
+                    last = stack.back();
+                    stack.pop_back();
+                }
+                stack.push_back(last);
+                stack.push_back(u[j]);
+            }
+        }
+        for (size_t i = 0; i + 1 < stack.size(); i++)
+            emit(u[m - 1].first, stack[i].first, stack[i + 1].first, indices);
+        return true;
+    }
+
+    bool MonotoneTriangulator::run(const RingList &rings, std::vector<uint32_t> &indices)
+    {
+        indices.clear();
+        if (rings.empty() || !buildRings(rings) || !makeMonotone())
+            return false;
+        indices.reserve((pts.size() + 2 * holesKept) * 3);
+        if (!triangulateFaces(indices))
+            return false;
+
+        // 三角形个数必须是 n + 2h - 2，且面积之和等于多边形面积，否则说明输入有自交等退化情况
+        if (indices.size() != (pts.size() + 2 * holesKept - 2) * 3)
+            return false;
+        // 校验面积：indices 已是原始下标，这里按去重后的顶点重新计算
+        double sum = 0;
+        std::vector<int> local(origIdx.empty() ? 0 : origIdx.back() + 1, -1);
+        for (size_t i = 0; i < origIdx.size(); i++)
+            local[origIdx[i]] = (int)i;
+        for (size_t i = 0; i < indices.size(); i += 3)
+            sum += std::abs(orient(pts[local[indices[i]]], pts[local[indices[i + 1]]], pts[local[indices[i + 2]]])) * 0.5;
+        return std::abs(sum - expectedArea) <= 1e-6 * std::abs(expectedArea);
+    }
+} // namespace
+
+bool monotoneTriangulate(const RingList &rings, std::vector<uint32_t> &indices)
+{
+    MonotoneTriangulator tri;
+    return tri.run(rings, indices);
+}
@@ -0,0 +1,239 @@
+﻿#include "output_sink.h"
+#include "io_ring.h"
+#ifdef CADPROC_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CADPROC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace
+{
+    const size_t kBlockSize = 64 * 1024;
+}
+
+bool outputCompressionAvailable(OutputCompression compression)
+{
+    switch (compression)
+    {
+    case OutputCompression::None:
+        return true;
+    case OutputCompression::Gzip:
+#ifdef CADPROC_HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case OutputCompression::Zstd:
+#ifdef CADPROC_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+const char *outputCompressionSuffix(OutputCompression compression)
+{
+    switch (compression)
+    {
+    case OutputCompression::Gzip:
+        return ".gz";
+    case OutputCompression::Zstd:
+        return ".zst";
+    default:
+        return "";
+    }
+}
+
+// 流式编码器：把一块输入编码后追加到 out，finish 为真时结束压缩流
+struct OutputSink::Codec
+{
+    virtual ~Codec() = default;
+    virtual bool encode(const char *data, size_t size, bool finish, std::vector<char> &out) = 0;
+};
+
+namespace
+{
+#ifdef CADPROC_HAVE_ZLIB
+    class GzipCodec : public OutputSink::Codec
+    {
+    public:
+        explicit GzipCodec(int level)
+        {
+            // windowBits 加 16 输出 gzip 头尾，可直接用 gunzip/zcat 解开
+            ok = deflateInit2(&zs, level > 0 ? level : Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                              Z_DEFAULT_STRATEGY) == Z_OK;
+        }
+        ~GzipCodec() override
+        {
+            if (ok)
+                deflateEnd(&zs);
+        }
+        bool encode(const char *data, size_t size, bool finish, std::vector<char> &out) override
+        {
+            if (!ok)
+                return false;
+            zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+            zs.avail_in = (uInt)size;
+            const int flush = finish ? Z_FINISH : Z_NO_FLUSH;
+            char chunk[kBlockSize];
+            int rc;
+            do
+            {
+                zs.next_out = reinterpret_cast<Bytef *>(chunk);
+                zs.avail_out = sizeof(chunk);
+                rc = deflate(&zs, flush);
+                if (rc == Z_STREAM_ERROR)
+                    return false;
+                out.insert(out.end(), chunk, chunk + (sizeof(chunk) - zs.avail_out));
+            } while (zs.avail_out == 0 || (finish && rc != Z_STREAM_END));
+            return true;
+        }
+
+    private:
+        z_stream zs{};
+        bool ok = false;
+    };
+#endif
+
+#ifdef CADPROC_HAVE_ZSTD
+    class ZstdCodec : public OutputSink::Codec
+    {
+    public:
+        explicit ZstdCodec(int level) : cctx(ZSTD_createCCtx())
+        {
+            if (cctx && level > 0)
+                ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+        }
+        ~ZstdCodec() override { ZSTD_freeCCtx(cctx); }
+        bool encode(const char *data, size_t size, bool finish, std::vector<char> &out) override
+        {
+            if (!cctx)
+                return false;
+            ZSTD_inBuffer in{data, size, 0};
+            std::vector<char> chunk(ZSTD_CStreamOutSize());
+            const ZSTD_EndDirective mode = finish ? ZSTD_e_end : ZSTD_e_continue;
+            size_t remaining;
+            do
+            {
+                ZSTD_outBuffer o{chunk.data(), chunk.size(), 0};
+                remaining = ZSTD_compressStream2(cctx, &o, &in, mode);
+                if (ZSTD_isError(remaining))
+                    return false;
+                out.insert(out.end(), chunk.data(), chunk.data() + o.pos);
+            } while (finish ? remaining != 0 : in.pos < in.size);
+            return true;
+        }
+
+    private:
+        ZSTD_CCtx *cctx;
+    };
+#endif
+} // namespace
+
+OutputSink::OutputSink(const std::string &path, const OutputOptions &options)
+{
+    switch (options.compression)
+    {
+#ifdef CADPROC_HAVE_ZLIB
+    case OutputCompression::Gzip:
+        codec = std::make_unique<GzipCodec>(options.level);
+        break;
+#endif
+#ifdef CADPROC_HAVE_ZSTD
+    case OutputCompression::Zstd:
+        codec = std::make_unique<ZstdCodec>(options.level);
+        break;
+#endif
+    default:
+        break;
+    }
+    ring = options.ring;
+    if (ring)
+        fd = ring->open(path);
+    else // 不压缩时保持文本模式，与原来直接用 ofstream 写出的换行一致
+        file.open(path, codec ? std::ios::out | std::ios::binary : std::ios::out);
+    block.resize(kBlockSize);
+    setp(block.data(), block.data() + block.size());
+}
+
+OutputSink::~OutputSink()
+{
+    close();
+}
+
+bool OutputSink::flushBlock(bool finish)
+{
+    const size_t size = (size_t)(pptr() - pbase());
+    raw += size;
+    setp(block.data(), block.data() + block.size());
+    if (!isOpen())
+        return false;
+
+    const char *data = block.data();
+    size_t bytes = size;
+    if (codec)
+    {
+        packed.clear();
+        if (!codec->encode(block.data(), size, finish, packed))
+        {
+            failed = true;
+            return false;
+        }
+        data = packed.data();
+        bytes = packed.size();
+    }
+    bool written;
+    if (ring)
+        written = ring->write(fd, data, bytes, stored);
+    else
+        written = bytes == 0 || (bool)file.write(data, (std::streamsize)bytes);
+    if (!written)
+    {
+        failed = true;
+        return false;
+    }
+    stored += bytes;
+    return true;
+}
+
+OutputSink::int_type OutputSink::overflow(int_type ch)
+{
+    if (!flushBlock(false))
+        return traits_type::eof();
+    if (!traits_type::eq_int_type(ch, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+int OutputSink::sync()
+{
+    // 压缩流中途不强制 flush，否则每次 sync 都会打断压缩块；数据在块满或 close 时写出
+    return failed ? -1 : 0;
+}
+
+bool OutputSink::close()
+{
+    if (closed)
+        return !failed;
+    closed = true;
+    flushBlock(true);
+    if (ring)
+    {
+        if (fd >= 0 && !ring->close(fd))
+            failed = true;
+        fd = -1;
+    }
+    else if (file.is_open())
+    {
+        file.close();
+        if (file.fail())
+            failed = true;
+    }
+    return !failed;
+}
@@ -0,0 +1,876 @@
+﻿#include "polygon_union.h"
+#include "containment.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+    // 非水平边，按 y 从下到上保存。w 为沿水平线从左向右跨过该边时环绕数的增量
+    struct BeamEdge
+    {
+        double x0, y0, x1, y1;
+        double dxdy; // 每束都要求一次 x，预先算好斜率倒数省掉除法
+        int w;
+        int ring;
+
+        double xAt(double y) const
+        {
+            if (y <= y0)
+                return x0;
+            if (y >= y1)
+                return x1;
+            return x0 + (y - y0) * dxdy;
+        }
+    };
+
+    // 水平边只参与相交检测
+    struct HorizontalEdge
+    {
+        double y, l, r;
+        int ring;
+    };
+
+    // 环内部的一个采样点，用来统计包住该环的其他环
+    struct SamplePoint
+    {
+        double x, y;
+        int ring;
+    };
+
+    // 当前扫描束中的一条边及其在束底、束顶处的 x。
+    // wind 为紧靠该边左侧的环绕数；run 记录该边正在输出的一段边界（+1 右侧填充、-1 左侧填充、0 不是边界）及其起点
+    struct ActiveSlot
+    {
+        double xb, xt;
+        int e;
+        int wind;
+        int run;
+        double runX, runY;
+    };
+
+    // 束内两条边的交点：left 与 right 在这里交换左右次序
+    struct Crossing
+    {
+        double y, x;
+        int left, right; // 边下标
+    };
+
+    // 输出的有向边界片段，填充区域在其左侧。src 为来源边（水平片段为 -1），拼环时用来合并共线的片段
+    struct BoundarySeg
+    {
+        double ax, ay, bx, by;
+        int src;
+    };
+
+    struct Interval
+    {
+        double l, r;
+    };
+
+    // 扫描束（Vatti）扫描：相邻两个顶点 y 之间的水平带称为束，束内活动边的次序只在交点处改变。
+    // 每个束先按束底 x 排好序，再对束顶 x 做冒泡排序，每次相邻交换就是一个束内交点，按 y 依次处理。
+    // 束只在顶点处划分，交点再多也不增加束的数量。Handler 提供以下回调：
+    //   level(yb, yt, active)  束底次序确定后
+    //   reorder(a, b)          两条边恰好在束底相交而交换次序
+    //   cross(c, left, right)  束内交点，回调之后两者交换
+    //   top(yt, active)        束内交点处理完、到达束顶时
+    //   retire(slot, y)        边到达上端点离开活动表
+    template <class Handler>
+    void sweepBeams(const std::vector<BeamEdge> &edges, Handler &h)
+    {
+        const size_t n = edges.size();
+        if (n == 0)
+            return;
+        std::vector<int> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](int a, int b)
+                  { return edges[a].y0 < edges[b].y0; });
+        std::vector<double> ys;
+        ys.reserve(n * 2);
+        for (const auto &e : edges)
+        {
+            ys.push_back(e.y0);
+            ys.push_back(e.y1);
+        }
+        std::sort(ys.begin(), ys.end());
+        ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+
+        // 束底 x、束顶 x 依次比较；同一位置上环绕数增加的边排在前面，使重合的公共边不会在中间留下缝
+        auto less = [&](const ActiveSlot &a, const ActiveSlot &b)
+        {
+            if (a.xb != b.xb)
+                return a.xb < b.xb;
+            if (a.xt != b.xt)
+                return a.xt < b.xt;
+            if (edges[a.e].w != edges[b.e].w)
+                return edges[a.e].w > edges[b.e].w;
+            return a.e < b.e;
+        };
+
+        std::vector<ActiveSlot> active, incoming, merged;
+        std::vector<int> pos(n), bubble;
+        std::vector<Crossing> crossings;
+        size_t nextEdge = 0, yi = 0;
+        double yb = ys.front();
+        for (;;)
+        {
+            while (yi < ys.size() && ys[yi] <= yb)
+                yi++;
+            active.erase(std::remove_if(active.begin(), active.end(), [&](const ActiveSlot &s)
+                                        {
+                                            if (edges[s.e].y1 > yb)
+                                                return false;
+                                            h.retire(s, yb);
+                                            return true; }),
+                         active.end());
+            incoming.clear();
+            while (nextEdge < n && edges[order[nextEdge]].y0 <= yb)
+            {
+                const int e = order[nextEdge++];
+                if (edges[e].y1 > yb)
+                    incoming.push_back({0, 0, e, 0, 0, 0, 0});
+            }
+            if (active.empty() && incoming.empty())
+            {
+                // 空束：只关闭下方残留的填充区间
+                h.level(yb, yb, active);
+                h.top(yb, active);
+                if (nextEdge == n)
+                    break;
+                yb = edges[order[nextEdge]].y0;
+                continue;
+            }
+
+            // 延续下来的边以上一束的束顶 x 作为束底 x（不重新计算），保证输出片段首尾严格相接
+            const double yt = ys[yi];
+            for (auto &s : active)
+                s.xt = edges[s.e].xAt(yt);
+            for (auto &s : incoming)
+                s.xb = edges[s.e].xAt(yb), s.xt = edges[s.e].xAt(yt);
+
+            // 延续下来的边沿用上一束束顶的次序，只差恰好在 yb 处相交的几对，插入排序即可修正
+            for (size_t i = 1; i < active.size(); i++)
+            {
+                for (size_t j = i; j > 0 && less(active[j], active[j - 1]); j--)
+                {
+                    h.reorder(active[j - 1].e, active[j].e);
+                    std::swap(active[j], active[j - 1]);
+                }
+            }
+            if (!incoming.empty())
+            {
+                std::sort(incoming.begin(), incoming.end(), less);
+                merged.clear();
+                std::merge(active.begin(), active.end(), incoming.begin(), incoming.end(), std::back_inserter(merged), less);
+                active.swap(merged);
+            }
+            h.level(yb, yt, active);
+
+            // 冒泡排序束顶 x：越过的每一对都在束内相交
+            crossings.clear();
+            bubble.resize(active.size());
+            std::iota(bubble.begin(), bubble.end(), 0);
+            for (size_t i = 1; i < bubble.size(); i++)
+            {
+                for (size_t j = i; j > 0 && active[bubble[j - 1]].xt > active[bubble[j]].xt; j--)
+                {
+                    const ActiveSlot &a = active[bubble[j - 1]], &b = active[bubble[j]];
+                    const double d0 = a.xb - b.xb, d1 = a.xt - b.xt;
+                    const double t = std::min(1.0, std::max(0.0, d0 / (d0 - d1)));
+                    crossings.push_back({yb + (yt - yb) * t, a.xb + (a.xt - a.xb) * t, a.e, b.e});
+                    std::swap(bubble[j - 1], bubble[j]);
+                }
+            }
+            if (!crossings.empty())
+            {
+                std::stable_sort(crossings.begin(), crossings.end(), [](const Crossing &a, const Crossing &b)
+                                 { return a.y < b.y; });
+                for (size_t i = 0; i < active.size(); i++)
+                    pos[active[i].e] = (int)i;
+                for (size_t k = 0; k < crossings.size(); k++)
+                {
+                    // 数值误差可能让按 y 排序的交点次序与实际相邻关系不符，换一个此刻相邻的交点先处理。
+                    // 剩下的交点恰好是尚未消除的逆序对，其中总有一对相邻
+                    auto adjacent = [&](const Crossing &c)
+                    { return std::abs(pos[c.left] - pos[c.right]) == 1; };
+                    if (!adjacent(crossings[k]))
+                    {
+                        for (size_t j = k + 1; j < crossings.size(); j++)
+                        {
+                            if (adjacent(crossings[j]))
+                            {
+                                std::swap(crossings[k], crossings[j]);
+                                break;
+                            }
+                        }
+                    }
+                    const Crossing &c = crossings[k];
+                    const int i = std::min(pos[c.left], pos[c.right]);
+                    h.cross(c, active[i], active[i + 1]);
+                    std::swap(active[i], active[i + 1]);
+                    pos[active[i].e] = i;
+                    pos[active[i + 1].e] = i + 1;
+                }
+            }
+
+            h.top(yt, active);
+            for (auto &s : active)
+                s.xb = s.xt;
+            yb = yt;
+        }
+    }
+
+    // 某一 y 上的水平边界：上方填充区间减去下方填充区间。只在上方填充的部分朝 +x，
+    // 只在下方填充的部分朝 -x，保持填充区域在左侧。区间按带符号覆盖计数，
+    // 数值误差造成的左右颠倒的极短区间自然得到反向的连接片段，边界仍能首尾相接
+    void emitHorizontal(double y, const std::vector<Interval> &below, const std::vector<Interval> &above,
+                        std::vector<BoundarySeg> &segs)
+    {
+        struct Mark
+        {
+            double x;
+            int delta; // 上方覆盖减下方覆盖的变化量
+        };
+        // 一层上通常只有个别顶点附近的区间发生变化，两端完全相同的区间直接跳过，不参与排序
+        size_t lo = 0, hiBelow = below.size(), hiAbove = above.size();
+        auto same = [](const Interval &a, const Interval &b)
+        { return a.l == b.l && a.r == b.r; };
+        while (lo < hiBelow && lo < hiAbove && same(below[lo], above[lo]))
+            lo++;
+        while (hiBelow > lo && hiAbove > lo && same(below[hiBelow - 1], above[hiAbove - 1]))
+            hiBelow--, hiAbove--;
+        std::vector<Mark> marks;
+        for (size_t i = lo; i < hiBelow; i++)
+        {
+            marks.push_back({below[i].l, -1});
+            marks.push_back({below[i].r, 1});
+        }
+        for (size_t i = lo; i < hiAbove; i++)
+        {
+            marks.push_back({above[i].l, 1});
+            marks.push_back({above[i].r, -1});
+        }
+        if (marks.empty())
+            return;
+        std::sort(marks.begin(), marks.end(), [](const Mark &a, const Mark &b)
+                  { return a.x < b.x; });
+
+        int cover = 0, run = 0;
+        double runStart = 0, prevX = marks.front().x;
+        auto flush = [&](double l, double r)
+        {
+            for (int k = 0; k < std::abs(run); k++)
+            {
+                if (run > 0)
+                    segs.push_back({l, y, r, y, -1});
+                else
+                    segs.push_back({r, y, l, y, -1});
+            }
+        };
+        for (size_t i = 0; i < marks.size();)
+        {
+            const double x = marks[i].x;
+            if (x > prevX && cover != run)
+            {
+                if (run != 0)
+                    flush(runStart, prevX);
+                run = cover;
+                runStart = prevX;
+            }
+            for (; i < marks.size() && marks[i].x == x; i++)
+                cover += marks[i].delta;
+            prevX = x;
+        }
+        if (run != 0)
+            flush(runStart, prevX);
+    }
+
+    struct PointKey
+    {
+        double x, y;
+        bool operator==(const PointKey &o) const { return x == o.x && y == o.y; }
+    };
+    struct PointKeyHash
+    {
+        size_t operator()(const PointKey &p) const
+        {
+            uint64_t a, b;
+            const double x = p.x + 0.0, y = p.y + 0.0; // 统一 -0.0 与 0.0
+            std::memcpy(&a, &x, sizeof(a));
+            std::memcpy(&b, &y, sizeof(b));
+            return (size_t)(a * 0x9E3779B97F4A7C15ull ^ (b + 0x7F4A7C15ull + (a << 6) + (a >> 2)));
+        }
+    };
+
+    // 把有向边界片段首尾相连拼成环。同一点有多条出边（两块只在顶点处相接）时取左转最大的一条，
+    // 让相接的两块各自成环，而不是拼成自相接的“8”字形。任何一条链断开都返回 false
+    bool stitchRings(const std::vector<BoundarySeg> &segs, std::vector<std::vector<Vertex>> &rings)
+    {
+        std::unordered_map<PointKey, std::vector<int>, PointKeyHash> outgoing;
+        outgoing.reserve(segs.size());
+        for (size_t i = 0; i < segs.size(); i++)
+        {
+            const auto &s = segs[i];
+            if (s.ax == s.bx && s.ay == s.by)
+                continue;
+            outgoing[{s.ax + 0.0, s.ay + 0.0}].push_back((int)i);
+        }
+
+        std::vector<char> used(segs.size(), 0);
+        std::vector<int> chain;
+        for (size_t first = 0; first < segs.size(); first++)
+        {
+            const auto &f = segs[first];
+            if (used[first] || (f.ax == f.bx && f.ay == f.by))
+                continue;
+            chain.clear();
+            int cur = (int)first;
+            for (;;)
+            {
+                used[cur] = 1;
+                chain.push_back(cur);
+                const BoundarySeg &c = segs[cur];
+                if (c.bx == f.ax && c.by == f.ay)
+                    break;
+                auto it = outgoing.find({c.bx + 0.0, c.by + 0.0});
+                if (it == outgoing.end())
+                    return false;
+                const double dx = c.bx - c.ax, dy = c.by - c.ay;
+                int best = -1;
+                double bestTurn = -4;
+                for (int cand : it->second)
+                {
+                    if (used[cand])
+                        continue;
+                    const double ex = segs[cand].bx - segs[cand].ax, ey = segs[cand].by - segs[cand].ay;
+                    const double turn = std::atan2(dx * ey - dy * ex, dx * ex + dy * ey);
+                    if (turn > bestTurn)
+                    {
+                        bestTurn = turn;
+                        best = cand;
+                    }
+                }
+                if (best < 0)
+                    return false;
+                cur = best;
+            }
+
+            // 去掉同一来源边（或同一条水平线）上的中间点，扫描束切出来的分段点不进入结果
+            const size_t k = chain.size();
+            std::vector<Vertex> ring;
+            ring.reserve(k);
+            for (size_t i = 0; i < k; i++)
+            {
+                const BoundarySeg &prev = segs[chain[(i + k - 1) % k]];
+                const BoundarySeg &s = segs[chain[i]];
+                if (prev.src == s.src && (s.src >= 0 || prev.ay == s.ay))
+                    continue;
+                Vertex v((float)s.ax, (float)s.ay, 0.0f);
+                if (!ring.empty() && ring.back().x == v.x && ring.back().y == v.y)
+                    continue;
+                ring.push_back(v);
+            }
+            while (ring.size() > 1 && ring.front().x == ring.back().x && ring.front().y == ring.back().y)
+                ring.pop_back();
+            if (ring.size() >= 3 && polygonSignedArea(ring) != 0)
+                rings.push_back(std::move(ring));
+        }
+        return true;
+    }
+
+    struct Box
+    {
+        double minX, minY, maxX, maxY;
+
+        bool contains(const Box &o) const
+        {
+            return o.minX >= minX && o.minY >= minY && o.maxX <= maxX && o.maxY <= maxY;
+        }
+    };
+
+    Box boundsOf(const std::vector<Vertex> &pts)
+    {
+        Box b{INFINITY, INFINITY, -INFINITY, -INFINITY};
+        for (const auto &v : pts)
+        {
+            b.minX = std::min(b.minX, (double)v.x);
+            b.minY = std::min(b.minY, (double)v.y);
+            b.maxX = std::max(b.maxX, (double)v.x);
+            b.maxY = std::max(b.maxY, (double)v.y);
+        }
+        return b;
+    }
+
+    uint64_t pairKey(int a, int b)
+    {
+        if (a > b)
+            std::swap(a, b);
+        return (uint64_t)(uint32_t)a << 32 | (uint32_t)b;
+    }
+
+    // 第一遍：找相互相交的环对（包括水平边穿过另一环非水平边的情况），
+    // 同时在采样点所在的束里按奇偶规则统计包住每个环的其他环
+    struct CrossingFinder
+    {
+        const std::vector<BeamEdge> &edges;
+        const std::vector<HorizontalEdge> &horizontals; // 按 y 排序
+        const std::vector<SamplePoint> &samples;        // 按 y 排序
+        std::unordered_set<uint64_t> crossing;
+        std::vector<std::vector<int>> containedBy;
+        std::vector<char> parity;
+        std::vector<int> touched;
+        size_t nextH = 0, nextS = 0;
+
+        CrossingFinder(const std::vector<BeamEdge> &e, const std::vector<HorizontalEdge> &hs,
+                       const std::vector<SamplePoint> &ss, size_t rings)
+            : edges(e), horizontals(hs), samples(ss), containedBy(rings), parity(rings, 0)
+        {
+        }
+
+        void note(int a, int b)
+        {
+            if (edges[a].ring != edges[b].ring)
+                crossing.insert(pairKey(edges[a].ring, edges[b].ring));
+        }
+
+        void level(double yb, double yt, const std::vector<ActiveSlot> &active)
+        {
+            while (nextH < horizontals.size() && horizontals[nextH].y < yb)
+                nextH++;
+            for (; nextH < horizontals.size() && horizontals[nextH].y == yb; nextH++)
+            {
+                const HorizontalEdge &h = horizontals[nextH];
+                auto it = std::upper_bound(active.begin(), active.end(), h.l, [](double x, const ActiveSlot &s)
+                                           { return x < s.xb; });
+                for (; it != active.end() && it->xb < h.r; ++it)
+                {
+                    const BeamEdge &e = edges[it->e];
+                    if (e.ring != h.ring && e.y0 < yb && it->xb > h.l)
+                        crossing.insert(pairKey(e.ring, h.ring));
+                }
+            }
+
+            while (nextS < samples.size() && samples[nextS].y < yb)
+                nextS++;
+            for (; nextS < samples.size() && samples[nextS].y < yt; nextS++)
+            {
+                const SamplePoint &q = samples[nextS];
+                const double f = (q.y - yb) / (yt - yb);
+                touched.clear();
+                for (const auto &s : active)
+                {
+                    const int r = edges[s.e].ring;
+                    if (r == q.ring || s.xb + (s.xt - s.xb) * f >= q.x)
+                        continue;
+                    if (!parity[r])
+                        touched.push_back(r);
+                    parity[r] ^= 1;
+                }
+                for (int r : touched)
+                {
+                    if (parity[r])
+                        containedBy[q.ring].push_back(r);
+                    parity[r] = 0;
+                }
+            }
+        }
+        void reorder(int a, int b) { note(a, b); }
+        void cross(const Crossing &c, ActiveSlot &, ActiveSlot &) { note(c.left, c.right); }
+        void top(double, std::vector<ActiveSlot> &) {}
+        void retire(const ActiveSlot &, double) {}
+    };
+
+    // 第二遍：非零环绕数求并。左右两侧环绕数一个低于 fillFrom、一个不低于它的边是边界，
+    // 束底、束顶的填充区间用于生成水平边界。一条边保持同一种边界状态时只输出一段
+    struct UnionBuilder
+    {
+        const std::vector<BeamEdge> &edges;
+        std::vector<BoundarySeg> segs;
+        std::vector<Interval> below, above;
+        int fillFrom = 1; // 环绕数达到该值的区域被填充；求交时为 2
+
+        explicit UnionBuilder(const std::vector<BeamEdge> &e) : edges(e) {}
+
+        int runOf(const ActiveSlot &s) const
+        {
+            const bool was = s.wind >= fillFrom, now = s.wind + edges[s.e].w >= fillFrom;
+            return was == now ? 0 : now ? 1
+                                        : -1;
+        }
+        void closeRun(const ActiveSlot &s, double x, double y)
+        {
+            if (s.run > 0)
+                segs.push_back({x, y, s.runX, s.runY, s.e}); // 右侧填充：向下走
+            else if (s.run < 0)
+                segs.push_back({s.runX, s.runY, x, y, s.e});
+        }
+        void updateRun(ActiveSlot &s, double x, double y)
+        {
+            const int run = runOf(s);
+            if (run == s.run)
+                return;
+            closeRun(s, x, y);
+            s.run = run;
+            s.runX = x;
+            s.runY = y;
+        }
+        // 按当前次序收集填充区间，x 取束底或束顶
+        static void collect(const std::vector<ActiveSlot> &active, bool atTop, std::vector<Interval> &out)
+        {
+            out.clear();
+            for (const auto &s : active)
+            {
+                const double x = atTop ? s.xt : s.xb;
+                if (s.run > 0)
+                    out.push_back({x, x});
+                else if (s.run < 0 && !out.empty())
+                    out.back().r = x;
+            }
+        }
+
+        void level(double yb, double, std::vector<ActiveSlot> &active)
+        {
+            int winding = 0;
+            for (auto &s : active)
+            {
+                s.wind = winding;
+                winding += edges[s.e].w;
+                updateRun(s, s.xb, yb);
+            }
+            collect(active, false, above);
+            emitHorizontal(yb, below, above, segs);
+        }
+        void reorder(int, int) {}
+        void cross(const Crossing &c, ActiveSlot &left, ActiveSlot &right)
+        {
+            // 交换后 right 在左：它左侧的环绕数不变，left 左侧多了 right 的增量
+            right.wind = left.wind;
+            left.wind = right.wind + edges[right.e].w;
+            updateRun(left, c.x, c.y);
+            updateRun(right, c.x, c.y);
+        }
+        void top(double, std::vector<ActiveSlot> &active) { collect(active, true, below); }
+        void retire(const ActiveSlot &s, double y) { closeRun(s, s.xb, y); }
+    };
+
+    // 标出完全重合的重复环（起点、走向可以不同）。重复绘制的多段线互相“包含”，会打乱按包含层数判定洞的奇偶，
+    // 并集里也不需要它们，只保留第一份
+    std::vector<char> findDuplicateRings(const std::vector<RawPoly> &cluster)
+    {
+        std::vector<char> duplicate(cluster.size(), 0);
+        std::vector<std::vector<Vertex>> canonical(cluster.size());
+        std::unordered_map<uint64_t, std::vector<size_t>> byHash;
+        for (size_t k = 0; k < cluster.size(); k++)
+        {
+            std::vector<Vertex> c = cluster[k].pts;
+            if (c.empty())
+                continue;
+            if (cluster[k].area < 0)
+                std::reverse(c.begin(), c.end());
+            std::rotate(c.begin(), std::min_element(c.begin(), c.end(), [](const Vertex &a, const Vertex &b)
+                                                    { return a.x < b.x || (a.x == b.x && a.y < b.y); }),
+                        c.end());
+            uint64_t h = 1469598103934665603ull; // FNV-1a
+            for (const auto &v : c)
+            {
+                uint32_t bits[2];
+                std::memcpy(&bits[0], &v.x, 4);
+                std::memcpy(&bits[1], &v.y, 4);
+                h = (h ^ bits[0]) * 1099511628211ull;
+                h = (h ^ bits[1]) * 1099511628211ull;
+            }
+            auto &same = byHash[h];
+            for (size_t j : same)
+            {
+                if (canonical[j].size() == c.size() &&
+                    std::equal(c.begin(), c.end(), canonical[j].begin(), [](const Vertex &a, const Vertex &b)
+                               { return a.x == b.x && a.y == b.y; }))
+                {
+                    duplicate[k] = 1;
+                    break;
+                }
+            }
+            if (!duplicate[k])
+            {
+                same.push_back(k);
+                canonical[k] = std::move(c);
+            }
+        }
+        return duplicate;
+    }
+
+    // 一个簇的并集。环的作用（外轮廓 +1 / 洞 -1）由包含深度决定，计算深度时不计与它相交的环
+    bool unionCluster(const std::vector<RawPoly> &cluster, std::vector<std::vector<Vertex>> &out)
+    {
+        const size_t m = cluster.size();
+        std::vector<BeamEdge> edges;
+        std::vector<HorizontalEdge> horizontals;
+        std::vector<SamplePoint> samples;
+        const std::vector<char> duplicate = findDuplicateRings(cluster);
+        for (size_t k = 0; k < m; k++)
+        {
+            const auto &pts = cluster[k].pts;
+            const size_t n = pts.size();
+            if (n < 3 || cluster[k].area == 0 || duplicate[k])
+                continue;
+            // 最左（再最下）的顶点必为凸顶点，沿两条邻边各走一小段取中点，落在环内部且离其他环的公共边有距离
+            size_t v = 0;
+            for (size_t i = 1; i < n; i++)
+                if (pts[i].x < pts[v].x || (pts[i].x == pts[v].x && pts[i].y < pts[v].y))
+                    v = i;
+            size_t a = (v + n - 1) % n, b = (v + 1) % n;
+            while (a != v && pts[a].x == pts[v].x && pts[a].y == pts[v].y)
+                a = (a + n - 1) % n;
+            while (b != v && pts[b].x == pts[v].x && pts[b].y == pts[v].y)
+                b = (b + 1) % n;
+            const double t = 0.005;
+            samples.push_back({pts[v].x + t * (((double)pts[a].x - pts[v].x) + ((double)pts[b].x - pts[v].x)),
+                               pts[v].y + t * (((double)pts[a].y - pts[v].y) + ((double)pts[b].y - pts[v].y)),
+                               (int)k});
+            for (size_t i = 0; i < n; i++)
+            {
+                const Vertex &a = pts[i];
+                const Vertex &b = pts[(i + 1) % n];
+                if (a.y == b.y)
+                {
+                    if (a.x != b.x)
+                        horizontals.push_back({a.y, std::min(a.x, b.x), std::max(a.x, b.x), (int)k});
+                    continue;
+                }
+                BeamEdge e;
+                e.ring = (int)k;
+                e.w = a.y < b.y ? -1 : 1; // 逆时针外环：向上的边在右侧，跨过后离开内部
+                if (a.y < b.y)
+                    e.x0 = a.x, e.y0 = a.y, e.x1 = b.x, e.y1 = b.y;
+                else
+                    e.x0 = b.x, e.y0 = b.y, e.x1 = a.x, e.y1 = a.y;
+                e.dxdy = (e.x1 - e.x0) / (e.y1 - e.y0);
+                edges.push_back(e);
+            }
+        }
+        if (edges.empty())
+            return true;
+
+        std::sort(horizontals.begin(), horizontals.end(), [](const HorizontalEdge &a, const HorizontalEdge &b)
+                  { return a.y < b.y; });
+        std::sort(samples.begin(), samples.end(), [](const SamplePoint &a, const SamplePoint &b)
+                  { return a.y < b.y; });
+        CrossingFinder finder(edges, horizontals, samples, m);
+        sweepBeams(edges, finder);
+
+        // 环的作用：被奇数个环包住的是洞。只有既不相交、包围盒也落在对方包围盒内的才算包住，
+        // 后者排除了只沿共线边或顶点相接、并没有真正相交的部分重叠。据此统一边的环绕数符号
+        std::vector<Box> box(m);
+        for (size_t k = 0; k < m; k++)
+            box[k] = boundsOf(cluster[k].pts);
+        std::vector<int> role(m, 1);
+        for (size_t k = 0; k < m; k++)
+        {
+            size_t depth = 0;
+            for (int r : finder.containedBy[k])
+                depth += box[r].contains(box[k]) && !finder.crossing.count(pairKey((int)k, r)) ? 1 : 0;
+            if (depth % 2 == 1)
+                role[k] = -1;
+        }
+        for (auto &e : edges)
+            e.w *= (cluster[e.ring].area > 0 ? 1 : -1) * role[e.ring];
+
+        UnionBuilder builder(edges);
+        sweepBeams(edges, builder);
+        return stitchRings(builder.segs, out);
+    }
+
+    // 把环的非水平边加入 edges，sign 为 +1 时逆时针环内部的环绕数为 +1
+    void addRingEdges(const std::vector<Vertex> &pts, int sign, int ring, std::vector<BeamEdge> &edges)
+    {
+        const size_t n = pts.size();
+        for (size_t i = 0; i < n; i++)
+        {
+            const Vertex &a = pts[i];
+            const Vertex &b = pts[(i + 1) % n];
+            if (a.y == b.y)
+                continue;
+            BeamEdge e;
+            e.ring = ring;
+            e.w = (a.y < b.y ? -1 : 1) * sign;
+            if (a.y < b.y)
+                e.x0 = a.x, e.y0 = a.y, e.x1 = b.x, e.y1 = b.y;
+            else
+                e.x0 = b.x, e.y0 = b.y, e.x1 = a.x, e.y1 = a.y;
+            e.dxdy = (e.x1 - e.x0) / (e.y1 - e.y0);
+            edges.push_back(e);
+        }
+    }
+
+    uint32_t findRoot(std::vector<uint32_t> &parent, uint32_t i)
+    {
+        while (parent[i] != i)
+        {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+} // namespace
+
+void unionFootprints(std::vector<RawPoly> &polys, UnionMode mode, UnionStats *stats)
+{
+    UnionStats local;
+    local.inputRings = polys.size();
+    const size_t m = polys.size();
+    if (mode == UnionMode::Off || m < 2)
+    {
+        local.outputRings = m;
+        if (stats)
+            *stats = local;
+        return;
+    }
+
+    std::vector<Box> box(m);
+    for (size_t i = 0; i < m; i++)
+        box[i] = boundsOf(polys[i].pts);
+
+    // 分区：按图层合并时每个图层一个分区
+    std::vector<uint32_t> part(m, 0);
+    if (mode == UnionMode::PerLayer)
+    {
+        std::unordered_map<std::string, uint32_t> ids;
+        for (size_t i = 0; i < m; i++)
+            part[i] = ids.emplace(polys[i].layer, (uint32_t)ids.size()).first->second;
+    }
+
+    // 同一分区内按 minX 扫描，包围盒相交（含相接）的多边形并入同一簇
+    std::vector<uint32_t> order(m);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+              {
+                  if (part[a] != part[b])
+                      return part[a] < part[b];
+                  return box[a].minX < box[b].minX; });
+    std::vector<uint32_t> parent(m);
+    std::iota(parent.begin(), parent.end(), 0u);
+    std::vector<uint32_t> sweep;
+    for (size_t k = 0; k < m; k++)
+    {
+        const uint32_t i = order[k];
+        if (k > 0 && part[order[k - 1]] != part[i])
+            sweep.clear();
+        sweep.erase(std::remove_if(sweep.begin(), sweep.end(), [&](uint32_t j)
+                                   { return box[j].maxX < box[i].minX; }),
+                    sweep.end());
+        for (uint32_t j : sweep)
+        {
+            if (box[j].minY <= box[i].maxY && box[i].minY <= box[j].maxY)
+                parent[findRoot(parent, i)] = findRoot(parent, j);
+        }
+        sweep.push_back(i);
+    }
+
+    // 每簇的成员按原始顺序串成链表
+    std::vector<uint32_t> root(m), size(m, 0), head(m, UINT32_MAX), next(m, UINT32_MAX);
+    for (size_t i = m; i-- > 0;)
+    {
+        root[i] = findRoot(parent, (uint32_t)i);
+        size[root[i]]++;
+        next[i] = head[root[i]];
+        head[root[i]] = (uint32_t)i;
+    }
+
+    // 结果按每簇第一个成员的原始位置排列，孤立的多边形原样搬过去
+    std::vector<RawPoly> result;
+    result.reserve(m);
+    std::vector<RawPoly> cluster;
+    std::vector<std::vector<Vertex>> rings;
+    for (size_t i = 0; i < m; i++)
+    {
+        const uint32_t r = root[i];
+        if (size[r] == 1)
+        {
+            result.push_back(std::move(polys[i]));
+            continue;
+        }
+        if (head[r] != i)
+            continue;
+        cluster.clear();
+        for (uint32_t j = head[r]; j != UINT32_MAX; j = next[j])
+            cluster.push_back(std::move(polys[j]));
+        local.clusters++;
+        rings.clear();
+        if (!unionCluster(cluster, rings))
+        {
+            // 数值问题导致边界没能闭合：保留原始多边形。簇里可能夹着别的多边形，
+            // HATCH 环不再紧挨着它的外环，改由包含关系重新判定
+            for (auto &p : cluster)
+            {
+                p.role = RingRole::Free;
+                result.push_back(std::move(p));
+            }
+            continue;
+        }
+        for (auto &ring : rings)
+        {
+            RawPoly p;
+            p.pts = std::move(ring);
+            p.layer = cluster.front().layer;
+            finalizeRawPoly(p);
+            result.push_back(std::move(p));
+        }
+    }
+    polys.swap(result);
+    local.outputRings = polys.size();
+    if (stats)
+        *stats = local;
+}
+
+bool clipRingsToRegion(const RingList &rings, const std::vector<Vertex> &outline,
+                       std::vector<std::vector<std::vector<Vertex>>> &pieces)
+{
+    // 外环内部环绕数 +1、洞内部 -1，区域内部再 +1：环绕数达到 2 的就是交集
+    std::vector<BeamEdge> edges;
+    for (size_t k = 0; k < rings.size(); k++)
+    {
+        const double area = polygonSignedArea(rings[k]);
+        if (rings[k].size() < 3 || area == 0)
+            continue;
+        addRingEdges(rings[k], (area > 0 ? 1 : -1) * (k == 0 ? 1 : -1), (int)k, edges);
+    }
+    addRingEdges(outline, polygonSignedArea(outline) > 0 ? 1 : -1, (int)rings.size(), edges);
+    UnionBuilder builder(edges);
+    builder.fillFrom = 2;
+    sweepBeams(edges, builder);
+    std::vector<std::vector<Vertex>> out;
+    if (!stitchRings(builder.segs, out))
+        return false;
+
+    // 填充区域在边界左侧：逆时针的是外环，顺时针的是洞，洞挂到直接包含它的外环上
+    std::vector<RawPoly> polys(out.size());
+    for (size_t i = 0; i < out.size(); i++)
+    {
+        polys[i].pts = std::move(out[i]);
+        finalizeRawPoly(polys[i]);
+    }
+    const ContainmentTree tree = buildContainmentTree(polys);
+    std::vector<int> pieceOf(polys.size(), -1);
+    for (size_t i = 0; i < polys.size(); i++)
+    {
+        if (polys[i].area > 0)
+        {
+            pieceOf[i] = (int)pieces.size();
+            pieces.emplace_back();
+            pieces.back().push_back(std::move(polys[i].pts));
+        }
+    }
+    for (size_t i = 0; i < polys.size(); i++)
+    {
+        const int parent = tree.parent[i];
+        if (polys[i].area < 0 && parent >= 0 && pieceOf[parent] >= 0)
+            pieces[pieceOf[parent]].push_back(std::move(polys[i].pts));
+    }
+    return true;
+}
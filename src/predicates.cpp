@@ -0,0 +1,80 @@
+﻿#include "predicates.h"
+
+namespace
+{
+    // 无误差变换：x 为浮点结果，y 为舍入误差，x + y 精确等于真实值
+
+    inline void twoSum(double a, double b, double &x, double &y)
+    {
+        x = a + b;
+        const double bv = x - a;
+        const double av = x - bv;
+        y = (a - av) + (b - bv);
+    }
+
+    inline void twoDiff(double a, double b, double &x, double &y)
+    {
+        x = a - b;
+        const double bv = a - x;
+        const double av = x + bv;
+        y = (a - av) + (bv - b);
+    }
+
+    inline void twoProduct(double a, double b, double &x, double &y)
+    {
+        x = a * b;
+        y = std::fma(a, b, -x);
+    }
+
+    // 把 b 加进按幅值递增、互不重叠的展开式 e（原地更新），去掉为 0 的分量，返回新长度
+    size_t growExpansion(double *e, size_t n, double b)
+    {
+        double q = b;
+        size_t out = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            double sum, err;
+            twoSum(q, e[i], sum, err);
+            q = sum;
+            if (err != 0)
+                e[out++] = err;
+        }
+        if (q != 0 || out == 0)
+            e[out++] = q;
+        return out;
+    }
+}
+
+double orient2dExact(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    // 行列式 (ax - cx)(by - cy) - (ay - cy)(bx - cx)：四个差值各拆成 hi + lo 两项，
+    // 展开后是 8 个乘积、16 个双精度分量，逐个累加成展开式，最高位分量决定符号
+    double acx, acxLo, bcy, bcyLo, acy, acyLo, bcx, bcxLo;
+    twoDiff(ax, cx, acx, acxLo);
+    twoDiff(by, cy, bcy, bcyLo);
+    twoDiff(ay, cy, acy, acyLo);
+    twoDiff(bx, cx, bcx, bcxLo);
+
+    const double left[2] = {acx, acxLo}, leftB[2] = {bcy, bcyLo};
+    const double right[2] = {acy, acyLo}, rightB[2] = {bcx, bcxLo};
+    double e[16];
+    size_t n = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            double p, pLo;
+            twoProduct(left[i], leftB[j], p, pLo);
+            n = growExpansion(e, n, pLo);
+            n = growExpansion(e, n, p);
+            twoProduct(right[i], rightB[j], p, pLo);
+            n = growExpansion(e, n, -pLo);
+            n = growExpansion(e, n, -p);
+        }
+    }
+    // 分量按幅值递增且互不重叠，从小到大求和不会改变最高位分量的符号
+    double sum = 0;
+    for (size_t i = 0; i < n; i++)
+        sum += e[i];
+    return sum;
+}
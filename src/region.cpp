@@ -0,0 +1,152 @@
+﻿#include "region.h"
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+    double cross(double ax, double ay, double bx, double by, double cx, double cy)
+    {
+        return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+    }
+
+    // 线段 ab 与 cd 是否相交（含端点相接与共线重叠）
+    bool segmentsIntersect(const Vertex &a, const Vertex &b, const Vertex &c, const Vertex &d)
+    {
+        const double d1 = cross(c.x, c.y, d.x, d.y, a.x, a.y);
+        const double d2 = cross(c.x, c.y, d.x, d.y, b.x, b.y);
+        const double d3 = cross(a.x, a.y, b.x, b.y, c.x, c.y);
+        const double d4 = cross(a.x, a.y, b.x, b.y, d.x, d.y);
+        if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+            return true;
+        auto onSegment = [](const Vertex &p, const Vertex &q, const Vertex &r)
+        {
+            return std::min(p.x, q.x) <= r.x && r.x <= std::max(p.x, q.x) &&
+                   std::min(p.y, q.y) <= r.y && r.y <= std::max(p.y, q.y);
+        };
+        return (d1 == 0 && onSegment(c, d, a)) || (d2 == 0 && onSegment(c, d, b)) ||
+               (d3 == 0 && onSegment(a, b, c)) || (d4 == 0 && onSegment(a, b, d));
+    }
+
+    // 两个环的边是否有交点，先按边的包围盒排除
+    bool edgesCross(const std::vector<Vertex> &ring, const std::vector<Vertex> &outline, const Bounds &outlineBounds)
+    {
+        const size_t n = ring.size(), m = outline.size();
+        for (size_t i = 0; i < n; i++)
+        {
+            const Vertex &a = ring[i], &b = ring[(i + 1) % n];
+            Bounds e;
+            e.add(a.x, a.y);
+            e.add(b.x, b.y);
+            if (!e.overlaps(outlineBounds))
+                continue;
+            for (size_t j = 0; j < m; j++)
+            {
+                if (segmentsIntersect(a, b, outline[j], outline[(j + 1) % m]))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    bool parseNumbers(std::string text, std::vector<double> &values)
+    {
+        std::replace(text.begin(), text.end(), ',', ' ');
+        std::replace(text.begin(), text.end(), ';', ' ');
+        std::istringstream in(text);
+        double v;
+        while (in >> v)
+            values.push_back(v);
+        return in.eof();
+    }
+} // namespace
+
+Bounds boundsOfRing(const std::vector<Vertex> &ring)
+{
+    Bounds b;
+    for (const auto &v : ring)
+        b.add(v.x, v.y);
+    return b;
+}
+
+Region Region::box(double minX, double minY, double maxX, double maxY)
+{
+    Region r;
+    if (minX > maxX)
+        std::swap(minX, maxX);
+    if (minY > maxY)
+        std::swap(minY, maxY);
+    r._outline = {Vertex((float)minX, (float)minY, 0.0f), Vertex((float)maxX, (float)minY, 0.0f),
+                  Vertex((float)maxX, (float)maxY, 0.0f), Vertex((float)minX, (float)maxY, 0.0f)};
+    r._bounds = {minX, minY, maxX, maxY};
+    r._isBox = true;
+    return r;
+}
+
+Region Region::polygon(std::vector<Vertex> outline)
+{
+    Region r;
+    if (outline.size() < 3)
+        return r;
+    if (polygonSignedArea(outline) < 0)
+        std::reverse(outline.begin(), outline.end());
+    r._bounds = boundsOfRing(outline);
+    r._outline = std::move(outline);
+    return r;
+}
+
+bool Region::parseBox(const std::string &text, Region &out)
+{
+    std::vector<double> v;
+    if (!parseNumbers(text, v) || v.size() != 4)
+        return false;
+    out = box(v[0], v[1], v[2], v[3]);
+    return true;
+}
+
+bool Region::parsePolygon(const std::string &text, Region &out)
+{
+    std::vector<double> v;
+    if (!parseNumbers(text, v) || v.size() % 2 != 0 || v.size() < 6)
+        return false;
+    std::vector<Vertex> pts;
+    for (size_t i = 0; i < v.size(); i += 2)
+        pts.emplace_back((float)v[i], (float)v[i + 1], 0.0f);
+    out = polygon(std::move(pts));
+    return out.active() && polygonSignedArea(out._outline) != 0;
+}
+
+bool Region::containsPoint(double x, double y) const
+{
+    if (x < _bounds.minX || x > _bounds.maxX || y < _bounds.minY || y > _bounds.maxY)
+        return false;
+    return _isBox || pointInPoly(_outline, x, y);
+}
+
+bool Region::intersectsRing(const std::vector<Vertex> &ring) const
+{
+    if (!active())
+        return true;
+    if (ring.empty())
+        return false;
+    const Bounds b = boundsOfRing(ring);
+    if (!_bounds.overlaps(b))
+        return false;
+    // 环上有点落在区域内、区域有点落在环内，或者两者边界相交
+    if (containsPoint(ring[0].x, ring[0].y))
+        return true;
+    if (pointInPoly(ring, _outline[0].x, _outline[0].y))
+        return true;
+    return edgesCross(ring, _outline, _bounds);
+}
+
+bool Region::containsRing(const std::vector<Vertex> &ring) const
+{
+    if (!active())
+        return true;
+    const Bounds b = boundsOfRing(ring);
+    if (_isBox)
+        return b.minX >= _bounds.minX && b.maxX <= _bounds.maxX && b.minY >= _bounds.minY && b.maxY <= _bounds.maxY;
+    if (ring.empty() || !containsPoint(ring[0].x, ring[0].y))
+        return false;
+    return !edgesCross(ring, _outline, _bounds);
+}
@@ -0,0 +1,29 @@
+#include "run_report.h"
+#include "mesh_optimize.h"
+#include <iomanip>
+
+void RunReport::print(std::ostream &os) const
+{
+    os << "---------------- Run report ----------------\n";
+    os << "Polygons parsed : " << polygons << "\n";
+    if (unionClusters > 0)
+        os << "Union           : " << unionClusters << " clusters, " << unionRings << " rings after merge\n";
+    os << "Groups          : " << groups << "\n";
+    os << "Triangles       : " << triangles << "\n";
+    os << "Culled walls    : " << culledWallTriangles << " triangles\n";
+    os << "Degraded groups : " << degraded.size() << "\n";
+    for (const auto &d : degraded)
+        os << "  shape_" << d.group << ": " << d.strategy << " - " << d.reason << "\n";
+    os << "Output writer   : " << writer << ", " << writerStalls << " stalls\n";
+    if (output.meshTriangles > 0)
+        os << "Vertex cache    : ACMR " << std::fixed << std::setprecision(3)
+           << (double)output.cacheMissesBefore / output.meshTriangles << " -> "
+           << (double)output.cacheMissesAfter / output.meshTriangles << std::defaultfloat
+           << " (FIFO " << kAcmrCacheSize << ")\n";
+    os << "Output files    : " << output.files << "\n";
+    os << "Output bytes    : " << output.rawBytes << " uncompressed, " << output.storedBytes << " written";
+    if (output.storedBytes > 0 && output.storedBytes != output.rawBytes)
+        os << " (" << std::fixed << std::setprecision(2) << (double)output.rawBytes / output.storedBytes
+           << ":1)" << std::defaultfloat;
+    os << "\n";
+}
@@ -0,0 +1,90 @@
+﻿#include "shard.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace
+{
+    // 把 [lo, hi] 等分成 n 段，返回第 k 条分界线；k == 0 与 k == n 时为无穷远
+    double splitLine(double lo, double hi, unsigned n, unsigned k)
+    {
+        if (k == 0)
+            return -INFINITY;
+        if (k >= n)
+            return INFINITY;
+        return lo + (hi - lo) * k / n;
+    }
+
+    // x 落在第几段：左闭右开，分界线与 shardCell 用同一个函数算出
+    unsigned slotOf(double lo, double hi, unsigned n, double x)
+    {
+        unsigned k = 0;
+        while (k + 1 < n && x >= splitLine(lo, hi, n, k + 1))
+            k++;
+        return k;
+    }
+} // namespace
+
+void shardGrid(const ShardSpec &spec, unsigned &cols, unsigned &rows)
+{
+    // 在 count 的因子中选使格子最接近正方形的列数
+    const double w = std::max(spec.extent.maxX - spec.extent.minX, 1e-9);
+    const double h = std::max(spec.extent.maxY - spec.extent.minY, 1e-9);
+    cols = 1;
+    double best = INFINITY;
+    for (unsigned c = 1; c <= spec.count; c++)
+    {
+        if (spec.count % c != 0)
+            continue;
+        const double aspect = std::fabs(std::log((w / c) / (h / (spec.count / c))));
+        if (aspect < best)
+            best = aspect, cols = c;
+    }
+    rows = spec.count / cols;
+}
+
+unsigned shardOwner(const ShardSpec &spec, double x, double y)
+{
+    unsigned cols, rows;
+    shardGrid(spec, cols, rows);
+    const Bounds &e = spec.extent;
+    return slotOf(e.minY, e.maxY, rows, y) * cols + slotOf(e.minX, e.maxX, cols, x);
+}
+
+Bounds shardCell(const ShardSpec &spec, unsigned index)
+{
+    unsigned cols, rows;
+    shardGrid(spec, cols, rows);
+    const Bounds &e = spec.extent;
+    const unsigned col = index % cols, row = index / cols;
+    Bounds b;
+    b.minX = splitLine(e.minX, e.maxX, cols, col);
+    b.maxX = splitLine(e.minX, e.maxX, cols, col + 1);
+    b.minY = splitLine(e.minY, e.maxY, rows, row);
+    b.maxY = splitLine(e.minY, e.maxY, rows, row + 1);
+    return b;
+}
+
+std::string formatShardSpec(const ShardSpec &spec)
+{
+    std::ostringstream out;
+    out.precision(17);
+    out << spec.index << "/" << spec.count << "@" << spec.extent.minX << "," << spec.extent.minY << ","
+        << spec.extent.maxX << "," << spec.extent.maxY;
+    return out.str();
+}
+
+bool parseShardSpec(const std::string &text, ShardSpec &out)
+{
+    std::istringstream in(text);
+    ShardSpec spec;
+    char slash = 0, at = 0, c1 = 0, c2 = 0, c3 = 0;
+    if (!(in >> spec.index >> slash >> spec.count >> at >> spec.extent.minX >> c1 >> spec.extent.minY >> c2 >>
+          spec.extent.maxX >> c3 >> spec.extent.maxY))
+        return false;
+    if (slash != '/' || at != '@' || c1 != ',' || c2 != ',' || c3 != ',' || spec.count == 0 || spec.index >= spec.count ||
+        spec.extent.empty())
+        return false;
+    out = spec;
+    return true;
+}
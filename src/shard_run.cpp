@@ -0,0 +1,274 @@
+﻿#include "shard_run.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include "spatial_order.h"
+#include "utils.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // 加引号，作为 shell 命令中的一个参数
+    std::string shellQuote(const std::string &s)
+    {
+#ifdef _WIN32
+        std::string out = "\"";
+        for (char c : s)
+        {
+            if (c == '"')
+                out += '\\';
+            out += c;
+        }
+        return out + "\"";
+#else
+        std::string out = "'";
+        for (char c : s)
+        {
+            if (c == '\'')
+                out += "'\\''";
+            else
+                out += c;
+        }
+        return out + "'";
+#endif
+    }
+
+    void replaceAll(std::string &text, const std::string &key, const std::string &value)
+    {
+        for (size_t pos = 0; (pos = text.find(key, pos)) != std::string::npos; pos += value.size())
+            text.replace(pos, key.size(), value);
+    }
+
+    // argv[0] 不含目录时按 PATH 查找，原样使用；否则转成绝对路径，worker 在分片目录里也能找到
+    std::string resolveExecutable(const std::string &exe)
+    {
+        const fs::path p(exe);
+        return p.has_parent_path() ? fs::absolute(p).string() : exe;
+    }
+} // namespace
+
+bool writeShardManifest(const std::string &path, const ShardManifest &manifest)
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        return false;
+    out.precision(17);
+    out << "# cadproc manifest: group shard index file triangles minX minY maxX maxY layer\n";
+    if (!manifest.spec.empty())
+        out << "spec\t" << manifest.spec << "\n";
+    for (const auto &e : manifest.entries)
+        out << "group\t" << e.shard << "\t" << e.index << "\t" << e.file << "\t" << e.triangles << "\t" << e.bounds.minX
+            << "\t" << e.bounds.minY << "\t" << e.bounds.maxX << "\t" << e.bounds.maxY << "\t" << e.layer << "\n";
+    out.flush();
+    return out.good();
+}
+
+bool readShardManifest(const std::string &path, ShardManifest &manifest)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    ShardManifest m;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::vector<std::string> fields;
+        std::istringstream split(line);
+        for (std::string f; std::getline(split, f, '\t');)
+            fields.push_back(f);
+        if (fields[0] == "spec" && fields.size() == 2)
+            m.spec = fields[1];
+        else if (fields[0] == "group" && fields.size() >= 9)
+        {
+            ShardManifestEntry e;
+            std::istringstream nums(fields[1] + " " + fields[2] + " " + fields[4] + " " + fields[5] + " " + fields[6] +
+                                    " " + fields[7] + " " + fields[8]);
+            if (!(nums >> e.shard >> e.index >> e.triangles >> e.bounds.minX >> e.bounds.minY >> e.bounds.maxX >> e.bounds.maxY))
+                return false;
+            e.file = fields[3];
+            e.layer = fields.size() > 9 ? fields[9] : "";
+            m.entries.push_back(std::move(e));
+        }
+        else
+            return false;
+    }
+    manifest = std::move(m);
+    return true;
+}
+
+int runShardCoordinator(const std::string &exe, const std::string &filename, const std::vector<std::string> &workerArgs,
+                        const ConvertOptions &options, const ShardRunOptions &run)
+{
+    ShardSpec base;
+    base.count = run.shards;
+    if (!readCadExtents(filename, options, base.extent))
+    {
+        std::cerr << "Failed to read drawing extents.\n";
+        return 1;
+    }
+    unsigned cols, rows;
+    shardGrid(base, cols, rows);
+    std::cout << "Shards: " << run.shards << " (" << cols << " x " << rows << ") over extent [" << base.extent.minX << ", "
+              << base.extent.minY << "] - [" << base.extent.maxX << ", " << base.extent.maxY << "]\n";
+
+    // 每个分片一个目录与一条命令，worker 的输出重定向到目录下的 worker.log
+    const std::string program = resolveExecutable(exe);
+    const std::string input = fs::absolute(filename).string();
+    std::vector<ShardSpec> specs(run.shards, base);
+    std::vector<fs::path> dirs(run.shards);
+    std::vector<std::string> commands(run.shards);
+    for (unsigned i = 0; i < run.shards; i++)
+    {
+        specs[i].index = i;
+        dirs[i] = fs::absolute(fs::path(run.workDir) / ("shard_" + std::to_string(i)));
+        std::error_code ec;
+        fs::remove_all(dirs[i], ec);
+        if (!fs::create_directories(dirs[i], ec))
+        {
+            std::cerr << "Failed to create " << dirs[i].string() << ".\n";
+            return 1;
+        }
+        std::string cmd = "cd " + shellQuote(dirs[i].string()) + " && " + shellQuote(program);
+        for (const auto &arg : workerArgs)
+            cmd += " " + shellQuote(arg);
+        cmd += " --shard " + shellQuote(formatShardSpec(specs[i])) + " " + shellQuote(input) + " > worker.log 2>&1";
+        if (!run.launch.empty())
+        {
+            std::string launched = run.launch;
+            replaceAll(launched, "{i}", std::to_string(i));
+            replaceAll(launched, "{cmd}", shellQuote(cmd));
+            cmd = launched;
+        }
+        commands[i] = cmd;
+    }
+
+    // 所有 worker 同时启动，每个由一个线程等待其退出
+    std::vector<int> exitCodes(run.shards, 0);
+    {
+        std::vector<std::thread> waiters;
+        for (unsigned i = 0; i < run.shards; i++)
+            waiters.emplace_back([&, i]()
+                                 { exitCodes[i] = std::system(commands[i].c_str()); });
+        for (auto &t : waiters)
+            t.join();
+    }
+    bool failed = false;
+    std::vector<ShardManifest> manifests(run.shards);
+    for (unsigned i = 0; i < run.shards; i++)
+    {
+        const fs::path log = dirs[i] / "worker.log";
+        if (exitCodes[i] != 0)
+        {
+            std::cerr << "Shard " << i << " failed (status " << exitCodes[i] << "), see " << log.string() << ".\n";
+            failed = true;
+        }
+        else if (!readShardManifest((dirs[i] / "manifest.tsv").string(), manifests[i]) ||
+                 manifests[i].spec != formatShardSpec(specs[i]))
+        {
+            std::cerr << "Shard " << i << " left no valid manifest, see " << log.string() << ".\n";
+            failed = true;
+        }
+    }
+    if (failed)
+        return 1; // 保留分片目录以便排查
+
+    // 合并：每个 group 只归一个分片，正常情况下不会重复；万一同一个 group 出现在两个分片里
+    // （同图层、同包围盒、同三角形数），只保留编号较小的分片的那份
+    ShardManifest merged;
+    std::set<std::tuple<std::string, double, double, double, double, size_t>> seen;
+    std::vector<std::tuple<std::string, double, double, double, double, size_t>> keys;
+    size_t duplicates = 0;
+    for (unsigned i = 0; i < run.shards; i++)
+    {
+        keys.clear();
+        for (const auto &e : manifests[i].entries)
+        {
+            auto key = std::make_tuple(e.layer, e.bounds.minX, e.bounds.minY, e.bounds.maxX, e.bounds.maxY, e.triangles);
+            if (seen.count(key))
+            {
+                duplicates++;
+                continue;
+            }
+            keys.push_back(key); // 同一分片内的叠放副本是不同的 group，不互相去重
+            merged.entries.push_back(e);
+        }
+        seen.insert(keys.begin(), keys.end());
+    }
+    if (options.hilbertOrder)
+    {
+        // 各分片内部已按 Hilbert 序排列，合并后按整张图重新排一次，编号在分片之间也连续
+        const double span = std::max(base.extent.maxX - base.extent.minX, base.extent.maxY - base.extent.minY);
+        const double scale = span > 0 ? 65535.0 / span : 0.0;
+        auto key = [&](const ShardManifestEntry &e)
+        {
+            const double cx = std::clamp(((e.bounds.minX + e.bounds.maxX) * 0.5 - base.extent.minX) * scale, 0.0, 65535.0);
+            const double cy = std::clamp(((e.bounds.minY + e.bounds.maxY) * 0.5 - base.extent.minY) * scale, 0.0, 65535.0);
+            return hilbertIndex((uint32_t)cx, (uint32_t)cy);
+        };
+        std::stable_sort(merged.entries.begin(), merged.entries.end(), [&](const ShardManifestEntry &a, const ShardManifestEntry &b)
+                         { return key(a) < key(b); });
+    }
+
+    // 把文件移到当前目录并统一编号，压缩后缀沿用 worker 写出的文件名
+    std::vector<size_t> shardGroups(run.shards, 0), shardTriangles(run.shards, 0);
+    size_t triangles = 0;
+    for (size_t k = 0; k < merged.entries.size(); k++)
+    {
+        ShardManifestEntry &e = merged.entries[k];
+        const size_t ext = e.file.find(".obj");
+        const std::string name = groupObjFileName(k, OutputCompression::None) + (ext == std::string::npos ? "" : e.file.substr(ext + 4));
+        const fs::path from = dirs[e.shard] / e.file;
+        std::error_code ec;
+        fs::remove(name, ec);
+        fs::rename(from, name, ec);
+        if (ec)
+        {
+            // 分片目录与当前目录不在同一文件系统时改为复制
+            ec.clear();
+            fs::copy_file(from, name, fs::copy_options::overwrite_existing, ec);
+            if (ec)
+            {
+                std::cerr << "Failed to move " << from.string() << " to " << name << ": " << ec.message() << "\n";
+                return 1;
+            }
+        }
+        e.index = k;
+        e.file = name;
+        shardGroups[e.shard]++;
+        shardTriangles[e.shard] += e.triangles;
+        triangles += e.triangles;
+    }
+    if (!writeShardManifest("manifest.tsv", merged))
+    {
+        std::cerr << "Failed to write manifest.tsv.\n";
+        return 1;
+    }
+    if (!run.keepShardDirs)
+    {
+        std::error_code ec;
+        for (const auto &dir : dirs)
+            fs::remove_all(dir, ec);
+        fs::remove(run.workDir, ec); // 只在目录已空时删除
+    }
+
+    std::cout << "---------------- Shard report ----------------\n";
+    for (unsigned i = 0; i < run.shards; i++)
+        std::cout << std::left << std::setw(16) << ("Shard " + std::to_string(i)) << std::right << ": " << shardGroups[i] << " groups, " << shardTriangles[i] << " triangles\n";
+    std::cout << "Groups          : " << merged.entries.size() << "\n";
+    std::cout << "Triangles       : " << triangles << "\n";
+    std::cout << "Duplicates      : " << duplicates << " dropped while merging\n";
+    std::cout << "Manifest        : manifest.tsv\n";
+    return 0;
+}
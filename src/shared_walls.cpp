@@ -0,0 +1,131 @@
+﻿#include "shared_walls.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace
+{
+    // 一条定向为“实体在左侧”的边，按高度与起点所在的容差网格单元排序分桶
+    struct WallEdge
+    {
+        float height;
+        int64_t cx, cy; // 起点所在网格单元
+        float ax, ay, bx, by;
+        size_t flag;             // 在 flags 中的位置
+        size_t poly, edge;       // 所在多边形与边号
+        const Vertex *from, *to; // 按多边形存储方向的端点
+    };
+
+    bool cellLess(const WallEdge &e, float height, int64_t cx, int64_t cy)
+    {
+        if (e.height != height)
+            return e.height < height;
+        if (e.cx != cx)
+            return e.cx < cx;
+        return e.cy < cy;
+    }
+} // namespace
+
+void SharedWalls::build(const std::vector<RawPoly> &polys, const PolyGrouping &grouping,
+                        const std::vector<float> &heights, double tolerance)
+{
+    offset.assign(polys.size() + 1, 0);
+    for (size_t k = 0; k < polys.size(); k++)
+        offset[k + 1] = offset[k] + polys[k].pts.size();
+    flags.assign(offset.back(), 0);
+    links.clear();
+    culledCount = 0;
+
+    const double cell = tolerance > 0 ? tolerance : 1e-9;
+    auto cellOf = [cell](double v)
+    { return (int64_t)std::floor(v / cell); };
+
+    std::vector<WallEdge> edges;
+    edges.reserve(offset.back());
+    auto addRing = [&](size_t poly, float height, bool hole)
+    {
+        const auto &pts = polys[poly].pts;
+        const size_t n = pts.size();
+        if (n < 2)
+            return;
+        // 逆时针外环的内部在左侧；洞取反，顺时针再取反
+        const bool flip = (polys[poly].area < 0) != hole;
+        for (size_t i = 0; i < n; i++)
+        {
+            const Vertex &a = pts[i];
+            const Vertex &b = pts[(i + 1) % n];
+            const Vertex &s = flip ? b : a;
+            const Vertex &t = flip ? a : b;
+            edges.push_back({height, cellOf(s.x), cellOf(s.y), s.x, s.y, t.x, t.y, offset[poly] + i, poly, i, &a, &b});
+        }
+    };
+    for (size_t g = 0; g < grouping.groups.size(); g++)
+    {
+        const PolyGroup &pg = grouping.groups[g];
+        addRing(pg.outer, heights[g], false);
+        for (size_t k = 0; k < pg.holeCount; k++)
+            addRing(grouping.holes[pg.holeBegin + k], heights[g], true);
+    }
+    std::sort(edges.begin(), edges.end(), [](const WallEdge &a, const WallEdge &b)
+              { return cellLess(a, b.height, b.cx, b.cy); });
+
+    // 反向边的起点就是本边的终点：在终点所在及相邻的 3x3 单元里找终点与本边起点重合的边，
+    // 重合的边都记下来，某一侧退化时据此恢复另一侧的墙面
+    for (const WallEdge &e : edges)
+    {
+        const int64_t ex = cellOf(e.bx), ey = cellOf(e.by);
+        bool shared = false;
+        for (int64_t dx = -1; dx <= 1; dx++)
+        {
+            for (int64_t dy = -1; dy <= 1; dy++)
+            {
+                const int64_t qx = ex + dx, qy = ey + dy;
+                auto it = std::lower_bound(edges.begin(), edges.end(), 0, [&](const WallEdge &f, int)
+                                           { return cellLess(f, e.height, qx, qy); });
+                for (; it != edges.end() && it->height == e.height && it->cx == qx && it->cy == qy; ++it)
+                {
+                    if (it->flag == e.flag)
+                        continue;
+                    if (std::fabs((double)it->ax - e.bx) <= tolerance && std::fabs((double)it->ay - e.by) <= tolerance &&
+                        std::fabs((double)it->bx - e.ax) <= tolerance && std::fabs((double)it->by - e.ay) <= tolerance)
+                    {
+                        shared = true;
+                        links.push_back({e.flag, {it->poly, it->edge, *it->from, *it->to}});
+                    }
+                }
+            }
+        }
+        if (shared)
+        {
+            flags[e.flag] = 1;
+            culledCount++;
+        }
+    }
+    std::sort(links.begin(), links.end(), [](const Link &a, const Link &b)
+              { return a.flag < b.flag; });
+}
+
+std::vector<SharedWalls::Partner> SharedWalls::partners(size_t poly, size_t edge) const
+{
+    std::vector<Partner> out;
+    if (flags.empty())
+        return out;
+    const size_t flag = offset[poly] + edge;
+    auto it = std::lower_bound(links.begin(), links.end(), flag, [](const Link &l, size_t f)
+                               { return l.flag < f; });
+    for (; it != links.end() && it->flag == flag; ++it)
+        out.push_back(it->partner);
+    return out;
+}
+
+void SharedWalls::restore(size_t poly, size_t edge)
+{
+    if (flags.empty())
+        return;
+    char &flag = flags[offset[poly] + edge];
+    if (flag)
+    {
+        flag = 0;
+        culledCount--;
+    }
+}
@@ -0,0 +1,211 @@
+﻿#include "small_poly.h"
+#include <array>
+#include <utility>
+
+namespace
+{
+    // > 0 为左转（逆时针），< 0 为右转
+    inline double orient(const Vertex &a, const Vertex &b, const Vertex &c)
+    {
+        return ((double)b.x - a.x) * ((double)c.y - a.y) - ((double)b.y - a.y) * ((double)c.x - a.x);
+    }
+
+    inline void emit(SmallTriangles &out, uint16_t a, uint16_t b, uint16_t c)
+    {
+        out.idx[out.count++] = a;
+        out.idx[out.count++] = b;
+        out.idx[out.count++] = c;
+    }
+
+    // 顶点按逆时针排好的次序；返回 false 表示面积为 0
+    template <size_t N>
+    bool ccwOrder(const Vertex *pts, uint16_t (&ord)[N])
+    {
+        double area2 = 0;
+        for (size_t i = 0, j = N - 1; i < N; j = i++)
+            area2 += (double)pts[j].x * pts[i].y - (double)pts[i].x * pts[j].y;
+        for (size_t i = 0; i < N; i++)
+            ord[i] = (uint16_t)(area2 < 0 ? N - 1 - i : i);
+        return area2 != 0;
+    }
+
+    // 严格凸：每个顶点都左转，且边方向的 y 分量只变号两次（排除五角星这类绕两圈的环）
+    template <size_t N>
+    bool isConvex(const Vertex *pts, const uint16_t (&ord)[N])
+    {
+        int flips = 0;
+        double lastDy = 0;
+        for (size_t i = 0; i < N; i++)
+        {
+            const Vertex &a = pts[ord[(i + N - 1) % N]], &b = pts[ord[i]], &c = pts[ord[(i + 1) % N]];
+            if (orient(a, b, c) <= 0)
+                return false;
+            const double dy = (double)c.y - b.y;
+            if (dy != 0)
+            {
+                if (lastDy != 0 && (dy > 0) != (lastDy > 0))
+                    flips++;
+                lastDy = dy;
+            }
+        }
+        // 首尾两条边之间的变号在循环里没算到
+        const double firstDy = (double)pts[ord[1]].y - pts[ord[0]].y;
+        if (firstDy != 0 && lastDy != 0 && (firstDy > 0) != (lastDy > 0))
+            flips++;
+        return flips <= 2;
+    }
+
+    // 点在逆时针三角形内部或边上
+    inline bool inTriangle(const Vertex &a, const Vertex &b, const Vertex &c, const Vertex &p)
+    {
+        return orient(a, b, p) >= 0 && orient(b, c, p) >= 0 && orient(c, a, p) >= 0;
+    }
+
+    // 剪耳：环用栈上的 prev/next 数组串起来，每轮找一个不含其它顶点的凸角切掉。
+    // 简单多边形里只有凹角（含共线点）可能落在耳内，凸角不必检查
+    template <size_t N>
+    bool clipEars(const Vertex *pts, const uint16_t (&ord)[N], SmallTriangles &out)
+    {
+        uint16_t prev[N], next[N];
+        bool convex[N];
+        for (size_t i = 0; i < N; i++)
+        {
+            prev[i] = (uint16_t)((i + N - 1) % N);
+            next[i] = (uint16_t)((i + 1) % N);
+        }
+        auto updateConvex = [&](uint16_t v)
+        { convex[v] = orient(pts[ord[prev[v]]], pts[ord[v]], pts[ord[next[v]]]) > 0; };
+        for (uint16_t i = 0; i < N; i++)
+            updateConvex(i);
+        size_t remaining = N;
+        uint16_t cur = 0, stop = 0;
+        auto unlink = [&](uint16_t v)
+        {
+            next[prev[v]] = next[v];
+            prev[next[v]] = prev[v];
+            updateConvex(prev[v]);
+            updateConvex(next[v]);
+            remaining--;
+        };
+        while (remaining > 3)
+        {
+            const uint16_t p = prev[cur], n = next[cur];
+            const Vertex &a = pts[ord[p]], &b = pts[ord[cur]], &c = pts[ord[n]];
+            bool ear = convex[cur];
+            for (uint16_t v = next[n]; ear && v != p; v = next[v])
+                ear = convex[v] || !inTriangle(a, b, c, pts[ord[v]]);
+            if (ear)
+            {
+                emit(out, ord[p], ord[cur], ord[n]);
+                unlink(cur);
+                cur = stop = n;
+                continue;
+            }
+            cur = n;
+            if (cur != stop)
+                continue;
+            // 转了一整圈没有耳：先去掉共线点再试，仍没有则是自交等退化输入
+            size_t k = 0;
+            while (k < remaining && orient(pts[ord[prev[cur]]], pts[ord[cur]], pts[ord[next[cur]]]) != 0)
+            {
+                cur = next[cur];
+                k++;
+            }
+            if (k == remaining)
+                return false;
+            const uint16_t after = next[cur];
+            unlink(cur);
+            cur = stop = after;
+        }
+        const uint16_t p = prev[cur], n = next[cur];
+        if (orient(pts[ord[p]], pts[ord[cur]], pts[ord[n]]) > 0)
+            emit(out, ord[p], ord[cur], ord[n]);
+        return out.count > 0;
+    }
+
+    template <size_t N>
+    struct SmallPolyKernel
+    {
+        static bool run(const Vertex *pts, SmallTriangles &out)
+        {
+            uint16_t ord[N];
+            if (!ccwOrder(pts, ord))
+                return false;
+            if (isConvex(pts, ord))
+            {
+                // 凸多边形：以首点为中心扇形展开
+                for (size_t i = 1; i + 1 < N; i++)
+                    emit(out, ord[0], ord[i], ord[i + 1]);
+                return true;
+            }
+            return clipEars(pts, ord, out);
+        }
+    };
+
+    template <>
+    struct SmallPolyKernel<3>
+    {
+        static bool run(const Vertex *pts, SmallTriangles &out)
+        {
+            uint16_t ord[3];
+            if (!ccwOrder(pts, ord))
+                return false;
+            emit(out, ord[0], ord[1], ord[2]);
+            return true;
+        }
+    };
+
+    // 四边形：凸时沿较短的对角线切开；恰有一个凹角（或共线点）时只能从它出发切
+    template <>
+    struct SmallPolyKernel<4>
+    {
+        static bool run(const Vertex *pts, SmallTriangles &out)
+        {
+            uint16_t ord[4];
+            if (!ccwOrder(pts, ord))
+                return false;
+            int reflex = -1, reflexCount = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                if (orient(pts[ord[(i + 3) & 3]], pts[ord[i]], pts[ord[(i + 1) & 3]]) <= 0)
+                {
+                    reflex = i;
+                    reflexCount++;
+                }
+            }
+            if (reflexCount > 1)
+                return false; // 自交或退化，交给 earcut
+            int k = reflex;
+            if (k < 0)
+            {
+                const Vertex &a = pts[ord[0]], &b = pts[ord[1]], &c = pts[ord[2]], &d = pts[ord[3]];
+                const double d02 = ((double)c.x - a.x) * ((double)c.x - a.x) + ((double)c.y - a.y) * ((double)c.y - a.y);
+                const double d13 = ((double)d.x - b.x) * ((double)d.x - b.x) + ((double)d.y - b.y) * ((double)d.y - b.y);
+                k = d13 < d02 ? 1 : 0;
+            }
+            emit(out, ord[k], ord[(k + 1) & 3], ord[(k + 2) & 3]);
+            emit(out, ord[k], ord[(k + 2) & 3], ord[(k + 3) & 3]);
+            return true;
+        }
+    };
+
+    using SmallKernel = bool (*)(const Vertex *, SmallTriangles &);
+
+    template <size_t... I>
+    constexpr std::array<SmallKernel, sizeof...(I)> makeKernels(std::index_sequence<I...>)
+    {
+        return {{&SmallPolyKernel<I + 3>::run...}};
+    }
+
+    // kernels[n - 3] 处理 n 个顶点的环
+    constexpr auto kernels = makeKernels(std::make_index_sequence<kSmallPolyMaxVertices - 2>());
+} // namespace
+
+bool triangulateSmallRing(const std::vector<Vertex> &ring, SmallTriangles &out)
+{
+    out.count = 0;
+    const size_t n = ring.size();
+    if (n < 3 || n > kSmallPolyMaxVertices)
+        return false;
+    return kernels[n - 3](ring.data(), out);
+}
@@ -0,0 +1,63 @@
+﻿#include "spatial_order.h"
+#include <algorithm>
+#include <cmath>
+#include "region.h"
+
+uint32_t hilbertIndex(uint32_t x, uint32_t y)
+{
+    // 从最高位起逐层确定象限，并把坐标旋转/翻转到该象限的局部朝向
+    uint32_t d = 0;
+    for (uint32_t s = 1u << 15; s > 0; s >>= 1)
+    {
+        const uint32_t rx = (x & s) ? 1 : 0;
+        const uint32_t ry = (y & s) ? 1 : 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = s - 1 - (x & (s - 1));
+                y = s - 1 - (y & (s - 1));
+            }
+            std::swap(x, y);
+        }
+        x &= s - 1;
+        y &= s - 1;
+    }
+    return d;
+}
+
+void sortGroupsByHilbert(const std::vector<RawPoly> &polys, PolyGrouping &grouping)
+{
+    auto &groups = grouping.groups;
+    if (groups.size() < 2)
+        return;
+
+    // 各 group 外环包围盒的中心，以及所有中心的包围盒（映射到网格的范围）
+    std::vector<std::pair<double, double>> centers(groups.size());
+    Bounds extent;
+    for (size_t i = 0; i < groups.size(); i++)
+    {
+        const Bounds b = boundsOfRing(polys[groups[i].outer].pts);
+        centers[i] = b.empty() ? std::make_pair(0.0, 0.0) : std::make_pair((b.minX + b.maxX) * 0.5, (b.minY + b.maxY) * 0.5);
+        extent.add(centers[i].first, centers[i].second);
+    }
+    // 两个方向用同一比例，保持曲线在平面上的形状
+    const double span = std::max(extent.maxX - extent.minX, extent.maxY - extent.minY);
+    const double scale = span > 0 ? 65535.0 / span : 0.0;
+
+    std::vector<std::pair<uint32_t, uint32_t>> keys(groups.size()); // (序号, 原位置)
+    for (size_t i = 0; i < groups.size(); i++)
+    {
+        const auto gx = (uint32_t)std::lround((centers[i].first - extent.minX) * scale);
+        const auto gy = (uint32_t)std::lround((centers[i].second - extent.minY) * scale);
+        keys[i] = {hilbertIndex(gx, gy), (uint32_t)i};
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<PolyGroup> sorted;
+    sorted.reserve(groups.size());
+    for (const auto &k : keys)
+        sorted.push_back(groups[k.second]);
+    groups.swap(sorted);
+}
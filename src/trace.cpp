@@ -0,0 +1,143 @@
+﻿#include "trace.h"
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char *name;
+        uint64_t startNs, endNs;
+        int argCount;
+        const char *keys[TraceScope::kMaxArgs];
+        int64_t values[TraceScope::kMaxArgs];
+    };
+
+    // 每个线程一份，线程退出后仍由 registry 持有，写出时才读取
+    struct ThreadLog
+    {
+        uint32_t tid;
+        const char *name = nullptr;
+        std::vector<TraceEvent> events;
+    };
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadLog>> logs;
+        std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    };
+
+    Registry &registry()
+    {
+        static Registry r;
+        return r;
+    }
+
+    // 线程第一次记录事件时登记，之后只访问 thread_local 指针
+    ThreadLog &threadLog()
+    {
+        thread_local ThreadLog *log = nullptr;
+        if (!log)
+        {
+            Registry &r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.logs.push_back(std::make_unique<ThreadLog>());
+            log = r.logs.back().get();
+            log->tid = (uint32_t)r.logs.size();
+            log->events.reserve(1024);
+        }
+        return *log;
+    }
+
+    uint64_t nowNs()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - registry().epoch)
+            .count();
+    }
+
+    // 纳秒写成带三位小数的微秒，trace 格式的时间单位是微秒
+    void writeMicros(std::ostream &os, uint64_t ns)
+    {
+        os << ns / 1000 << '.' << (char)('0' + ns / 100 % 10) << (char)('0' + ns / 10 % 10) << (char)('0' + ns % 10);
+    }
+} // namespace
+
+void Trace::enable()
+{
+    registry(); // 以开启时刻作为时间零点
+    on = true;
+}
+
+void Trace::setThreadName(const char *name)
+{
+    if (on)
+        threadLog().name = name;
+}
+
+long Trace::write(const std::string &path)
+{
+    std::ofstream os(path, std::ios::binary);
+    if (!os)
+        return -1;
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    long count = 0;
+    bool first = true;
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (const auto &log : r.logs)
+    {
+        if (log->name)
+        {
+            os << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << log->tid
+               << ",\"args\":{\"name\":\"" << log->name << "\"}}";
+            first = false;
+        }
+        for (const auto &e : log->events)
+        {
+            // 完整事件（ph = X）：开始时间 + 持续时间
+            os << (first ? "" : ",\n") << "{\"name\":\"" << e.name << "\",\"cat\":\"cadproc\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+               << log->tid << ",\"ts\":";
+            writeMicros(os, e.startNs);
+            os << ",\"dur\":";
+            writeMicros(os, e.endNs - e.startNs);
+            if (e.argCount > 0)
+            {
+                os << ",\"args\":{";
+                for (int k = 0; k < e.argCount; k++)
+                    os << (k ? "," : "") << '"' << e.keys[k] << "\":" << e.values[k];
+                os << '}';
+            }
+            os << '}';
+            first = false;
+            count++;
+        }
+    }
+    os << "\n]}\n";
+    return os ? count : -1;
+}
+
+void TraceScope::begin(const char *eventName)
+{
+    name = eventName;
+    startNs = nowNs();
+}
+
+void TraceScope::end()
+{
+    TraceEvent e;
+    e.name = name;
+    e.startNs = startNs;
+    e.endNs = nowNs();
+    e.argCount = argCount;
+    for (int k = 0; k < argCount; k++)
+    {
+        e.keys[k] = keys[k];
+        e.values[k] = values[k];
+    }
+    threadLog().events.push_back(e);
+}
@@ -1,4 +1,34 @@
 ﻿#include "utils.h"
+#include "mesh_optimize.h"
+#include "monotone.h"
+#include "small_poly.h"
+#include "trace.h"
+#include <algorithm>
+#include <cctype>
+
+// DWG 以版本号 "AC10xx" 开头，紧跟二进制数据；二进制 DXF 有固定的哨兵串；其余按 ASCII DXF 处理
+CadFileKind detectCadFileKind(const std::string &filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+    if (!in.is_open())
+        return CadFileKind::Unknown;
+    char head[22] = {};
+    in.read(head, sizeof(head));
+    return detectCadBufferKind(head, (size_t)in.gcount());
+}
+
+CadFileKind detectCadBufferKind(const char *head, size_t n)
+{
+    static const char binarySentinel[] = "AutoCAD Binary DXF";
+    if (n >= sizeof(binarySentinel) - 1 &&
+        std::string(head, sizeof(binarySentinel) - 1) == binarySentinel)
+        return CadFileKind::BinaryDxf;
+    if (n >= 7 && std::string(head, 4) == "AC10" &&
+        std::isdigit((unsigned char)head[4]) && std::isdigit((unsigned char)head[5]) &&
+        !std::isprint((unsigned char)head[6]) && head[6] != '\r' && head[6] != '\n')
+        return CadFileKind::Dwg;
+    return n > 0 ? CadFileKind::AsciiDxf : CadFileKind::Unknown;
+}
 
 // 利用二维 Green 定理的离散化计算多边形有向面积
 double polygonSignedArea(const std::vector<Vertex> &pts)
@@ -13,79 +43,371 @@ double polygonSignedArea(const std::vector<Vertex> &pts)
     return 0.5 * a;
 }
 
-// 射线法判断点是否在多边形内
-bool pointInPoly(const std::vector<Vertex> &poly, double x, double y)
+// 把圆离散成 segments 边的正多边形
+RawPoly makeCirclePoly(double cx, double cy, double radius, int segments)
 {
-    bool inside = false;
-    size_t n = poly.size();
-    for (size_t i = 0, j = n - 1; i < n; j = i++)
+    RawPoly p;
+    p.pts.reserve(segments);
+    for (int i = 0; i < segments; i++)
     {
-        double xi = poly[i].x, yi = poly[i].y;
-        double xj = poly[j].x, yj = poly[j].y;
-        // &&前面的表达式判断点知否在这条边的上下之间
-        // 后面的表达式表示多边形边与水平线Y的交点在X轴上的位置x'，因为向右射线，所以是 x < 交点的 x' 坐标
-        // 其中1e-18避免浮点数除以0，(边平行于射线的时候)
-        bool intersect = ((yi > y) != (yj > y)) &&
-                         (x < (xj - xi) * (y - yi) / (yj - yi + 1e-18) + xi);
-        if (intersect)
-            inside = !inside;
+        double theta = 2.0 * M_PI * i / segments;
+        p.pts.push_back({(float)(cx + cos(theta) * radius),
+                         (float)(cy + sin(theta) * radius),
+                         0.0f});
     }
-    return inside;
+    p.area = polygonSignedArea(p.pts);
+    p.shape = PolyShape::Circle;
+    p.cx = (float)cx;
+    p.cy = (float)cy;
+    p.radius = (float)radius;
+    return p;
 }
 
-// 把 2D 多边形“拉升成立体柱体”，并生成底面和顶面的三角形
-std::vector<Vertex> triangulateRingsToTris(const std::vector<std::vector<Vertex>> &polygonRings, float zTop, float zBottom)
+bool isConvexRing(const std::vector<Vertex> &pts)
 {
-    // prepare earcut input
-    using Point = std::pair<float, float>;
-    std::vector<std::vector<Point>> data;
-    for (auto &ring : polygonRings)
+    const size_t n = pts.size();
+    if (n < 3)
+        return false;
+    const double area = polygonSignedArea(pts);
+    if (area == 0)
+        return false;
+    const double sign = area > 0 ? 1.0 : -1.0;
+    int flips = 0;
+    double firstDy = 0, lastDy = 0;
+    for (size_t i = 0; i < n; i++)
     {
-        std::vector<Point> r;
-        for (auto &p : ring)
-            r.push_back({p.x, p.y});
-        data.push_back(std::move(r));
+        const Vertex &a = pts[(i + n - 1) % n], &b = pts[i], &c = pts[(i + 1) % n];
+        const double ux = (double)b.x - a.x, uy = (double)b.y - a.y;
+        const double vx = (double)c.x - b.x, vy = (double)c.y - b.y;
+        const double turn = (ux * vy - uy * vx) * sign;
+        if (turn < 0 || (turn == 0 && ux * vx + uy * vy < 0))
+            return false; // 右转，或者共线折返
+        if (vy != 0)
+        {
+            if (firstDy == 0)
+                firstDy = vy;
+            else if ((vy > 0) != (lastDy > 0))
+                flips++;
+            lastDy = vy;
+        }
     }
+    // 首尾两条非水平边之间的变号在循环里没算到
+    if ((firstDy > 0) != (lastDy > 0))
+        flips++;
+    return flips <= 2;
+}
 
-    std::vector<uint32_t> idx = mapbox::earcut<uint32_t>(data);
+// 折线读入后的收尾：计算有向面积，去掉与首点重合的闭合尾点，并标记凸环
+void finalizeRawPoly(RawPoly &p)
+{
+    p.area = polygonSignedArea(p.pts);
+    if (p.pts.size() > 1)
+    {
+        if (std::fabs(p.pts.front().x - p.pts.back().x) < 1e-6f &&
+            std::fabs(p.pts.front().y - p.pts.back().y) < 1e-6f)
+        {
+            p.pts.pop_back();
+        }
+    }
+    p.shape = isConvexRing(p.pts) ? PolyShape::Convex : PolyShape::General;
+}
 
-    // Flatten vertex list: earcut indices reference flattened list of rings concatenated in order
+// 射线法判断点是否在多边形内，落在边界上也算在内（精确谓词，见 predicates.h）
+bool pointInPoly(const std::vector<Vertex> &poly, double x, double y)
+{
+    return locatePointInRing(poly, x, y) != PointLocation::Outside;
+}
+
+// 由三角形下标生成底面与顶面：底面沿用 earcut 的顺序，顶面翻转顺序使法线朝外
+template <class Index>
+static std::vector<Vertex> buildCaps(const RingList &polygonRings, const Index *idx, size_t count,
+                                     float zTop, float zBottom)
+{
+    // earcut 的下标对应各环依次拼接后的顶点；只有一个环时直接用它，不必拼接
     std::vector<Vertex> flat;
-    for (auto &ring : polygonRings)
-        for (auto &v : ring)
-            flat.push_back({v.x, v.y, (float)zBottom});
+    const std::vector<Vertex> *src = &polygonRings[0];
+    if (polygonRings.size() > 1)
+    {
+        for (auto &ring : polygonRings)
+            flat.insert(flat.end(), ring.begin(), ring.end());
+        src = &flat;
+    }
+    const std::vector<Vertex> &pts = *src;
 
     // bottom triangles from earcut (assume earcut gives CCW for outer)
     std::vector<Vertex> tris;
-    for (size_t i = 0; i < idx.size(); i += 3)
-    {
-        Vertex a = flat[idx[i]];
-        Vertex b = flat[idx[i + 1]];
-        Vertex c = flat[idx[i + 2]];
-        tris.push_back(a);
-        tris.push_back(b);
-        tris.push_back(c);
-    }
+    tris.reserve(count * 2);
+    for (size_t i = 0; i < count; i++)
+        tris.push_back({pts[idx[i]].x, pts[idx[i]].y, zBottom});
     // top triangles: same indices but with z=zTop and reversed to flip normal outward
-    // we need a mapping from flat index to top coordinate
-    std::vector<Vertex> flatTop = flat;
-    for (auto &v : flatTop)
-        v.z = (float)zTop;
-    for (size_t i = 0; i < idx.size(); i += 3)
+    for (size_t i = 0; i < count; i += 3)
     {
         // reverse order for top
-        Vertex a = flatTop[idx[i]];
-        Vertex b = flatTop[idx[i + 2]];
-        Vertex c = flatTop[idx[i + 1]];
-        tris.push_back(a);
-        tris.push_back(b);
-        tris.push_back(c);
+        for (size_t k : {i, i + 2, i + 1})
+            tris.push_back({pts[idx[k]].x, pts[idx[k]].y, zTop});
     }
     return tris;
 }
 
+// 把 2D 多边形“拉升成立体柱体”，并生成底面和顶面的三角形
+static bool preferMonotone(const RingList &polygonRings, const TriangulationOptions &options)
+{
+    if (options.engine != TriEngine::Auto)
+        return options.engine == TriEngine::Monotone;
+    size_t vertexCount = 0;
+    for (auto &ring : polygonRings)
+        vertexCount += ring.size();
+    return vertexCount >= options.monotoneMinVertices || polygonRings.size() > options.monotoneMinHoles;
+}
+
+std::vector<Vertex> triangulateRingsToTris(const RingList &polygonRings, float zTop, float zBottom,
+                                           const TriangulationOptions &options, TriangulationStatus *status,
+                                           bool convex)
+{
+    if (polygonRings.empty())
+        return {};
+
+    // 无洞的小多边形走定长内核；退化或自交时仍交给 earcut
+    if (options.engine == TriEngine::Auto && polygonRings.size() == 1)
+    {
+        SmallTriangles small;
+        if (triangulateSmallRing(polygonRings[0], small))
+        {
+            if (status)
+                *status = TriangulationStatus{true, false, 0, TriEngine::Small};
+            return buildCaps(polygonRings, small.idx, small.count, zTop, zBottom);
+        }
+    }
+
+    // 更大的凸环（圆等）以首点扇形展开。凸环的扇形三角形同号，按符号统一成逆时针，共线点造成的零面积三角形跳过
+    if (convex && options.engine == TriEngine::Auto && polygonRings.size() == 1)
+    {
+        const std::vector<Vertex> &ring = polygonRings[0];
+        std::vector<uint32_t> idx;
+        idx.reserve(ring.size() > 2 ? 3 * (ring.size() - 2) : 0);
+        const Vertex &o = ring[0];
+        for (uint32_t i = 1; i + 1 < ring.size(); i++)
+        {
+            const Vertex &a = ring[i], &b = ring[i + 1];
+            const double turn = ((double)a.x - o.x) * ((double)b.y - o.y) - ((double)a.y - o.y) * ((double)b.x - o.x);
+            if (turn > 0)
+                idx.insert(idx.end(), {0, i, i + 1});
+            else if (turn < 0)
+                idx.insert(idx.end(), {0, i + 1, i});
+        }
+        if (status)
+            *status = TriangulationStatus{true, false, 0, TriEngine::Fan};
+        return buildCaps(polygonRings, idx.data(), idx.size(), zTop, zBottom);
+    }
+
+    // 超大多边形走单调剖分；遇到退化输入时仍回退到 earcut
+    if (preferMonotone(polygonRings, options))
+    {
+        std::vector<uint32_t> idx;
+        if (monotoneTriangulate(polygonRings, idx))
+        {
+            if (status)
+                *status = TriangulationStatus{true, false, 0, TriEngine::Monotone};
+            return buildCaps(polygonRings, idx.data(), idx.size(), zTop, zBottom);
+        }
+    }
+
+    mapbox::detail::Earcut<uint32_t> earcut;
+    earcut.maxIterations = options.budget.maxIterations;
+    earcut.maxMillis = options.budget.maxMillis;
+    earcut.hashThreshold = options.earcutHashThreshold;
+    earcut(polygonRings); // earcut 经 nth<Vertex> 直接读取各环
+    if (status)
+        *status = TriangulationStatus{!earcut.aborted, earcut.timedOut, earcut.iterations, TriEngine::Earcut};
+    if (earcut.aborted)
+        return {};
+
+    return buildCaps(polygonRings, earcut.indices.data(), earcut.indices.size(), zTop, zBottom);
+}
+
+const char *capFallbackName(CapFallback f)
+{
+    switch (f)
+    {
+    case CapFallback::None:
+        return "earcut";
+    case CapFallback::Simplified:
+        return "simplified ring";
+    case CapFallback::ConvexHull:
+        return "convex hull";
+    case CapFallback::Skipped:
+        return "skipped";
+    }
+    return "";
+}
+
+// Douglas-Peucker 抽稀闭合环，以首点和离首点最远的点把环分成两条折线分别处理
+std::vector<Vertex> simplifyRing(const std::vector<Vertex> &ring, double tolerance)
+{
+    const size_t n = ring.size();
+    if (n < 4)
+        return ring;
+    size_t far = 0;
+    double farD = -1;
+    for (size_t i = 1; i < n; i++)
+    {
+        double dx = ring[i].x - ring[0].x, dy = ring[i].y - ring[0].y;
+        if (dx * dx + dy * dy > farD)
+        {
+            farD = dx * dx + dy * dy;
+            far = i;
+        }
+    }
+
+    std::vector<char> keep(n, 0);
+    keep[0] = keep[far] = 1;
+    std::vector<std::pair<size_t, size_t>> stack{{0, far}, {far, n}}; // 下标 n 表示回到首点
+    const double tol2 = tolerance * tolerance;
+    while (!stack.empty())
+    {
+        auto [first, last] = stack.back();
+        stack.pop_back();
+        const Vertex &a = ring[first];
+        const Vertex &b = ring[last % n];
+        double ex = b.x - a.x, ey = b.y - a.y;
+        double len2 = ex * ex + ey * ey;
+        size_t best = first;
+        double bestD = tol2;
+        for (size_t i = first + 1; i < last; i++)
+        {
+            double px = ring[i].x - a.x, py = ring[i].y - a.y;
+            double d2;
+            if (len2 > 0)
+            {
+                double cross = px * ey - py * ex;
+                d2 = cross * cross / len2;
+            }
+            else
+                d2 = px * px + py * py;
+            if (d2 > bestD)
+            {
+                bestD = d2;
+                best = i;
+            }
+        }
+        if (best != first)
+        {
+            keep[best] = 1;
+            stack.push_back({first, best});
+            stack.push_back({best, last});
+        }
+    }
+
+    std::vector<Vertex> out;
+    for (size_t i = 0; i < n; i++)
+        if (keep[i])
+            out.push_back(ring[i]);
+    return out;
+}
+
+// Andrew 单调链求凸包，结果为逆时针
+std::vector<Vertex> convexHull(const std::vector<Vertex> &pts)
+{
+    std::vector<Vertex> p = pts;
+    std::sort(p.begin(), p.end(), [](const Vertex &a, const Vertex &b)
+              { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+    if (p.size() < 3)
+        return p;
+    auto cross = [](const Vertex &o, const Vertex &a, const Vertex &b)
+    { return ((double)a.x - o.x) * ((double)b.y - o.y) - ((double)a.y - o.y) * ((double)b.x - o.x); };
+
+    std::vector<Vertex> hull;
+    hull.reserve(p.size() + 1);
+    for (size_t i = 0; i < p.size(); i++) // 下凸壳
+    {
+        while (hull.size() >= 2 && cross(hull[hull.size() - 2], hull.back(), p[i]) <= 0)
+            hull.pop_back();
+        hull.push_back(p[i]);
+    }
+    for (size_t i = p.size() - 1, lower = hull.size() + 1; i-- > 0;) // 上凸壳
+    {
+        while (hull.size() >= lower && cross(hull[hull.size() - 2], hull.back(), p[i]) <= 0)
+            hull.pop_back();
+        hull.push_back(p[i]);
+    }
+    hull.pop_back(); // 最后一点与首点重复
+    return hull;
+}
+
+CapFallback triangulateWithFallback(RingList &rings, float zTop, float zBottom, const TriangulationOptions &options,
+                                    std::vector<Vertex> &tris, std::string &reason,
+                                    std::vector<std::vector<Vertex>> &fallbackRings, bool convex)
+{
+    const TriangulationBudget &budget = options.budget;
+    TriangulationStatus st;
+    tris = triangulateRingsToTris(rings, zTop, zBottom, options, &st, convex);
+    if (st.completed)
+        return CapFallback::None;
+
+    std::ostringstream why;
+    if (st.timedOut)
+        why << "time budget of " << budget.maxMillis << " ms exceeded";
+    else
+        why << "iteration budget of " << budget.maxIterations << " exceeded";
+    size_t vertexCount = 0;
+    for (auto &r : rings)
+        vertexCount += r.size();
+    why << " (" << vertexCount << " vertices, " << rings.size() - 1 << " holes)";
+    reason = why.str();
+
+    // 1. 以外环包围盒对角线的 0.5% 为容差抽稀所有环，再试一次
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+    for (auto &v : rings[0])
+    {
+        minX = std::min(minX, v.x), maxX = std::max(maxX, v.x);
+        minY = std::min(minY, v.y), maxY = std::max(maxY, v.y);
+    }
+    const double tolerance = 0.005 * std::hypot((double)maxX - minX, (double)maxY - minY);
+    std::vector<std::vector<Vertex>> simplified;
+    for (auto &r : rings)
+    {
+        auto s = simplifyRing(r, tolerance);
+        if (s.size() >= 3)
+            simplified.push_back(std::move(s));
+        else if (simplified.empty())
+            break; // 外环退化
+    }
+    if (!simplified.empty())
+    {
+        tris = triangulateRingsToTris(simplified, zTop, zBottom, options, &st);
+        if (st.completed)
+        {
+            fallbackRings = std::move(simplified);
+            rings = RingList(fallbackRings);
+            return CapFallback::Simplified;
+        }
+    }
+
+    // 2. 外环凸包：凸多边形直接扇形三角化，不会再失败
+    std::vector<Vertex> hull = convexHull(rings[0]);
+    if (hull.size() < 3)
+    {
+        tris.clear();
+        rings.clear();
+        return CapFallback::Skipped;
+    }
+    std::vector<uint32_t> idx;
+    idx.reserve((hull.size() - 2) * 3);
+    for (uint32_t i = 1; i + 1 < hull.size(); i++)
+    {
+        // 凸包为逆时针，与 earcut 输出的底面朝向一致
+        idx.push_back(0);
+        idx.push_back(i);
+        idx.push_back(i + 1);
+    }
+    fallbackRings.assign(1, std::move(hull));
+    rings = RingList(fallbackRings);
+    tris = buildCaps(rings, idx.data(), idx.size(), zTop, zBottom);
+    return CapFallback::ConvexHull;
+}
+
 // 生成侧面三角形
-std::vector<Vertex> generateSideTriangles(const std::vector<Vertex> &ring, float height)
+std::vector<Vertex> generateSideTriangles(const std::vector<Vertex> &ring, float height, const char *culled)
 {
     std::vector<Vertex> side;
     size_t n = ring.size();
@@ -93,6 +415,8 @@ std::vector<Vertex> generateSideTriangles(const std::vector<Vertex> &ring, float
         return side;
     for (size_t i = 0; i < n; i++)
     {
+        if (culled && culled[i])
+            continue;
         size_t j = (i + 1) % n;
         Vertex b0 = ring[i];
         Vertex b1 = ring[j];
@@ -115,29 +439,70 @@ void appendVerts(std::vector<Vertex> &dst, const std::vector<Vertex> &src)
     dst.insert(dst.end(), src.begin(), src.end());
 }
 
-void exportGroupToOBJ(const std::vector<Vertex> &verts, size_t index)
+std::string groupObjFileName(size_t index, OutputCompression compression)
 {
     std::ostringstream fname;
-    fname << "shape_" << std::setw(3) << std::setfill('0') << index << ".obj";
-    std::ofstream out(fname.str());
-    if (!out.is_open())
+    fname << "shape_" << std::setw(3) << std::setfill('0') << index << ".obj" << outputCompressionSuffix(compression);
+    return fname.str();
+}
+
+bool exportGroupToOBJ(const std::vector<Vertex> &verts, size_t index, const OutputOptions &options,
+                      OutputStats *stats)
+{
+    TraceScope trace("export");
+    trace.arg("group", (int64_t)index).arg("triangles", (int64_t)(verts.size() / 3));
+    const std::string fname = groupObjFileName(index, options.compression);
+    OutputSink sink(fname, options);
+    if (!sink.isOpen())
     {
-        std::cerr << "Failed to open " << fname.str() << " for writing.\n";
-        return;
+        std::cerr << "Failed to open " << fname << " for writing.\n";
+        return false;
     }
+    std::ostream out(&sink);
 
-    // 写入顶点
-    for (const auto &v : verts)
+    if (options.optimizeMesh)
     {
-        out << "v " << v.x << " " << v.y << " " << v.z << "\n";
+        // 焊接成索引网格后先统计原顺序的缓存未命中，再重排三角形与顶点
+        IndexedMesh mesh = buildIndexedMesh(verts);
+        const size_t before = simulateVertexCacheMisses(mesh.indices, mesh.vertices.size());
+        optimizeVertexCache(mesh.indices, mesh.vertices.size());
+        optimizeVertexFetch(mesh);
+        const size_t after = simulateVertexCacheMisses(mesh.indices, mesh.vertices.size());
+        if (stats)
+        {
+            stats->meshTriangles += mesh.indices.size() / 3;
+            stats->cacheMissesBefore += before;
+            stats->cacheMissesAfter += after;
+        }
+        for (const auto &v : mesh.vertices)
+            out << "v " << v.x << " " << v.y << " " << v.z << "\n";
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+            out << "f " << mesh.indices[i] + 1 << " " << mesh.indices[i + 1] + 1 << " " << mesh.indices[i + 2] + 1 << "\n";
     }
-
-    // 写入面（每3个顶点为一个三角形）
-    for (size_t i = 0; i + 2 < verts.size(); i += 3)
+    else
     {
-        out << "f " << i + 1 << " " << i + 2 << " " << i + 3 << "\n";
+        // 写入顶点
+        for (const auto &v : verts)
+        {
+            out << "v " << v.x << " " << v.y << " " << v.z << "\n";
+        }
+
+        // 写入面（每3个顶点为一个三角形）
+        for (size_t i = 0; i + 2 < verts.size(); i += 3)
+        {
+            out << "f " << i + 1 << " " << i + 2 << " " << i + 3 << "\n";
+        }
     }
 
-    out.close();
-    std::cout << "Exported " << fname.str() << " (" << verts.size() / 3 << " triangles)\n";
+    out.flush();
+    const bool written = sink.close();
+    if (!written)
+        std::cerr << "Failed to write " << fname << ".\n";
+    if (stats)
+    {
+        stats->files++;
+        stats->rawBytes += sink.rawBytes();
+        stats->storedBytes += sink.storedBytes();
+    }
+    return written;
 }
\ No newline at end of file